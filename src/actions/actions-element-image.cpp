@@ -165,7 +165,7 @@ void image_crop(InkscapeApplication *app)
     // raster image to the geometric bounds of the clipping object.
     for (auto item : selection->items()) {
         if (auto image = cast<SPImage>(item)) {
-            bytes -= std::strlen(image->href);
+            bytes -= std::strlen(image->getHref());
             Geom::OptRect area;
             if (target) {
                 // MODE A. Crop to selected rectangle.
@@ -175,7 +175,7 @@ void image_crop(InkscapeApplication *app)
                 area = clip->geometricBounds(image->i2doc_affine());
             }
             done += (int)(area && image->cropToArea(*area));
-            bytes += std::strlen(image->href);
+            bytes += std::strlen(image->getHref());
         }
     }
     if (rect) {
@@ -23,10 +23,10 @@
 #include <glibmm/miscutils.h>
 
 #include "auto-save.h"
+#include "async/async.h"
 #include "document.h"
 #include "inkscape-application.h"
 #include "preferences.h"
-#include "extension/output.h"
 #include "helper/auto-connection.h"
 #include "io/sys.h"
 #include "xml/repr.h"
@@ -102,6 +102,14 @@ AutoSave::save()
     std::stringstream datetime;
     datetime << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
 
+    struct Job
+    {
+        SPDocument *document;
+        std::string path;
+        std::string contents;
+    };
+    std::vector<Job> jobs;
+
     int docnum = 0;
     int autosave_max = prefs->getInt("/options/autosave/max", 10);
     for (auto document : documents) {
@@ -143,34 +151,52 @@ AutoSave::save()
             std::string filename = base_name + "-" + datetime.str() + "-" + std::to_string(pid) + "-" + std::to_string(docnum) + ".svg";
             std::string path = Glib::build_filename(autosave_dir, filename.c_str());
 
-            // Try to save the file
-            // Following code needs to be reviewed
-            FILE *file = Inkscape::IO::fopen_utf8name(path.c_str(), "w");
-            gchar *errortext = nullptr;
-            if (file) {
-                try {
-                    Inkscape::XML::Node *repr = document->getReprRoot();
-                    sp_repr_save_stream(repr->document(), file, SP_SVG_NS_URI);
-                } catch (Inkscape::Extension::Output::no_extension_found &e) {
-                    errortext = g_strdup(_("Autosave failed! Could not find inkscape extension to save document."));
-                } catch (Inkscape::Extension::Output::save_failed &e) {
-                    auto const safeUri = Inkscape::IO::sanitizeString(path.c_str());
-                    errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri.c_str());
-                }
-                fclose(file);
-            } else {
-                auto const safeUri = Inkscape::IO::sanitizeString(path.c_str());
-                errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri.c_str());
-            }
+            // Serialize here, while the document cannot change, but leave writing it out, which
+            // takes a while for large documents, to another thread.
+            jobs.push_back({document, std::move(path), sp_repr_save_string(document->getReprDoc(), SP_SVG_NS_URI)});
+            document->setModifiedSinceAutoSaveFalse();
+        }
+    } // Loop over documents
+
+    if (jobs.empty()) {
+        return true;
+    }
 
-            if (errortext) {
-                g_warning("%s", errortext);
+    // All writes report back through the same channel, so that failures of an earlier save that
+    // is still being written are not lost.
+    if (!_channel) {
+        auto [src, dst] = Async::Channel::create();
+        _source = std::make_shared<Async::Channel::Source>(std::move(src));
+        _channel = std::move(dst);
+    }
+
+    Async::fire_and_forget([this, jobs = std::move(jobs), channel = _source] {
+        std::vector<SPDocument *> failed;
+        for (auto const &job : jobs) {
+            GError *error = nullptr;
+            if (!g_file_set_contents(job.path.c_str(), job.contents.data(), job.contents.size(), &error)) {
+                auto const safeUri = Inkscape::IO::sanitizeString(job.path.c_str());
+                gchar *errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri.c_str());
+                g_warning("%s %s", errortext, error->message);
                 g_free(errortext);
-            } else {
-                document->setModifiedSinceAutoSaveFalse();
+                g_error_free(error);
+                failed.push_back(job.document);
             }
         }
-    } // Loop over documents
+
+        if (failed.empty()) {
+            return;
+        }
+        channel->run([this, failed = std::move(failed)] {
+            // Try again next time, unless the document has been closed meanwhile.
+            auto const documents = _app->get_documents();
+            for (auto document : failed) {
+                if (std::find(documents.begin(), documents.end(), document) != documents.end()) {
+                    document->setModifiedSinceAutoSaveTrue();
+                }
+            }
+        });
+    });
 
     return true;
 }
@@ -13,6 +13,10 @@
 #ifndef INKSCAPE_AUTOSAVE_H
 #define INKSCAPE_AUTOSAVE_H
 
+#include <memory>
+
+#include "async/channel.h"
+
 class InkscapeApplication;
 
 namespace Inkscape {
@@ -40,6 +44,8 @@ public:
 
 private:
     InkscapeApplication* _app = nullptr;
+    Async::Channel::Dest _channel; ///< For hearing back from documents being written out.
+    std::shared_ptr<Async::Channel::Source const> _source; ///< Shared by all writes in flight.
 };
 
 } // namespace Inkscape
@@ -13,6 +13,7 @@
 
 #include "cms-system.h"
 
+#include <algorithm>
 #include <iomanip>
 
 #include <glibmm.h>
@@ -375,13 +376,110 @@ std::string CMSSystem::get_path_for_profile(Glib::ustring const &name) const
     return result;
 }
 
+// The lookup table samples every LUT_STEP-th value of each channel, so that the grid points are
+// exactly representable as 8-bit input.
+static constexpr int LUT_STEP = 5;
+static constexpr int LUT_SIZE = 255 / LUT_STEP + 1;
+
+CMSTransform::CMSTransform(cmsHTRANSFORM handle, bool lut)
+    : _handle(handle)
+{
+    assert(_handle);
+
+    if (lut) {
+        _lut.resize(LUT_SIZE * LUT_SIZE * LUT_SIZE * 4);
+        auto px = _lut.data();
+        for (int r = 0; r < LUT_SIZE; ++r) {
+            for (int g = 0; g < LUT_SIZE; ++g) {
+                for (int b = 0; b < LUT_SIZE; ++b) {
+                    *px++ = b * LUT_STEP;
+                    *px++ = g * LUT_STEP;
+                    *px++ = r * LUT_STEP;
+                    *px++ = 255;
+                }
+            }
+        }
+        cmsDoTransform(_handle, _lut.data(), _lut.data(), LUT_SIZE * LUT_SIZE * LUT_SIZE);
+    }
+}
+
+void CMSTransform::transform(unsigned char *row, unsigned width) const
+{
+    if (_lut.empty()) {
+        cmsDoTransform(_handle, row, row, width);
+        return;
+    }
+
+    // Tetrahedral interpolation: the cube around the input is split into six tetrahedra along
+    // its diagonal, and the output is blended from the four corners of the one containing it.
+    constexpr int dr = LUT_SIZE * LUT_SIZE * 4, dg = LUT_SIZE * 4, db = 4;
+
+    for (unsigned i = 0; i < width; ++i, row += 4) {
+        // Cells are found from their lower corner, so 255 goes in the last cell at its far end.
+        int const ib = std::min<int>(row[0] / LUT_STEP, LUT_SIZE - 2);
+        int const ig = std::min<int>(row[1] / LUT_STEP, LUT_SIZE - 2);
+        int const ir = std::min<int>(row[2] / LUT_STEP, LUT_SIZE - 2);
+        int const fb = row[0] - ib * LUT_STEP, fg = row[1] - ig * LUT_STEP, fr = row[2] - ir * LUT_STEP;
+        auto const c000 = _lut.data() + ir * dr + ig * dg + ib * db;
+
+        // Weights of the four corners, from the origin to the opposite corner, summing to LUT_STEP.
+        int w0, w1, w2, w3;
+        int o1, o2; // Offsets of the two intermediate corners.
+        if (fr >= fg) {
+            if (fg >= fb) {
+                o1 = dr; o2 = dr + dg;
+                w0 = LUT_STEP - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+            } else if (fr >= fb) {
+                o1 = dr; o2 = dr + db;
+                w0 = LUT_STEP - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+            } else {
+                o1 = db; o2 = dr + db;
+                w0 = LUT_STEP - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+            }
+        } else {
+            if (fb >= fg) {
+                o1 = db; o2 = dg + db;
+                w0 = LUT_STEP - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+            } else if (fb >= fr) {
+                o1 = dg; o2 = dg + db;
+                w0 = LUT_STEP - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+            } else {
+                o1 = dg; o2 = dr + dg;
+                w0 = LUT_STEP - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+            }
+        }
+
+        auto const c1 = c000 + o1, c2 = c000 + o2, c111 = c000 + dr + dg + db;
+        for (int c = 0; c < 3; ++c) {
+            row[c] = (w0 * c000[c] + w1 * c1[c] + w2 * c2[c] + w3 * c111[c] + LUT_STEP / 2) / LUT_STEP;
+        }
+    }
+}
+
 // Static, doesn't rely on class. Simply calls lcms' cmsDoTransform.
-// Called from Canvas and icc_color_to_sRGB in sgv-color.cpp.
+// Called from icc_color_to_sRGB in svg-color.cpp; the canvas goes through CMSTransform::transform().
 void CMSSystem::do_transform(cmsHTRANSFORM transform, unsigned char *inBuf, unsigned char *outBuf, unsigned size)
 {
     cmsDoTransform(transform, inBuf, outBuf, size);
 }
 
+std::shared_ptr<CMSTransform const> CMSSystem::get_transform_to_srgb(cmsHPROFILE profile, int intent)
+{
+    std::array<cmsUInt8Number, 16> id;
+    if (!cmsMD5computeID(profile)) {
+        return nullptr;
+    }
+    cmsGetHeaderProfileID(profile, id.data());
+
+    auto &transform = srgb_transforms[{id, intent}];
+    if (!transform) {
+        // Without the single pixel cache, lcms transforms are safe to share between threads.
+        transform = CMSTransform::create(
+            cmsCreateTransform(profile, TYPE_RGBA_8, sRGB_profile, TYPE_RGBA_8, intent, cmsFLAGS_NOCACHE));
+    }
+    return transform;
+}
+
 // Called by Canvas to obtain transform.
 // Currently there is one transform for all monitors.
 // Transform immutably shared between CMSSystem and Canvas.
@@ -440,13 +538,14 @@ std::shared_ptr<CMSTransform const> const &CMSSystem::get_cms_transform()
                 dwFlags |= cmsFLAGS_BLACKPOINTCOMPENSATION;
             }
 
+            // The gamut warning colour would bleed into its surroundings if interpolated.
             current_transform = CMSTransform::create(
                 cmsCreateProofingTransform(sRGB_profile, TYPE_BGRA_8, monitor_profile, TYPE_BGRA_8,
-                                           proof_profile, intent, proofIntent, dwFlags));
+                                           proof_profile, intent, proofIntent, dwFlags), !gamutWarn);
 
         } else if (monitor_profile) {
             current_transform = CMSTransform::create(
-                cmsCreateTransform(sRGB_profile, TYPE_BGRA_8, monitor_profile, TYPE_BGRA_8, intent, 0));
+                cmsCreateTransform(sRGB_profile, TYPE_BGRA_8, monitor_profile, TYPE_BGRA_8, intent, 0), true);
         }
     }
 
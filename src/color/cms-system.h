@@ -16,6 +16,8 @@
  * Track which profile to use on which monitor.
  */
 
+#include <array>
+#include <map>
 #include <vector>
 #include <memory>
 #include <cassert>
@@ -38,20 +40,31 @@ class ColorProfile;
 class CMSTransform
 {
 public:
-    explicit CMSTransform(cmsHTRANSFORM handle) : _handle(handle) { assert(_handle); }
+    /**
+     * Wrap a transform between 8-bit buffers with three colour channels followed by alpha.
+     *
+     * If lut is set, the transform is also sampled into a lookup table, which transform()
+     * interpolates instead of going through lcms for every pixel. This is much faster, but
+     * unsuitable for transforms with sharp edges, such as those showing gamut warnings.
+     */
+    explicit CMSTransform(cmsHTRANSFORM handle, bool lut = false);
     CMSTransform(CMSTransform const &) = delete;
     CMSTransform &operator=(CMSTransform const &) = delete;
     ~CMSTransform() { cmsDeleteTransform(_handle); }
 
     cmsHTRANSFORM getHandle() const { return _handle; }
 
-    static std::shared_ptr<CMSTransform> create(cmsHTRANSFORM handle)
+    /// Transform a row of pixels in place, leaving alpha alone.
+    void transform(unsigned char *row, unsigned width) const;
+
+    static std::shared_ptr<CMSTransform> create(cmsHTRANSFORM handle, bool lut = false)
     {
-        return handle ? std::make_shared<CMSTransform>(handle) : nullptr;
+        return handle ? std::make_shared<CMSTransform>(handle, lut) : nullptr;
     }
 
 private:
     cmsHTRANSFORM _handle;
+    std::vector<unsigned char> _lut; ///< B, G, R and padding for each grid point, or empty.
 };
 
 class CMSSystem
@@ -82,6 +95,15 @@ public:
     std::shared_ptr<CMSTransform const> const &get_cms_transform();
     static cmsHPROFILE get_document_profile(SPDocument *document, unsigned *intent, char const *name);
 
+    /**
+     * Get a transform from the given profile to sRGB, for TYPE_RGBA_8 pixels.
+     *
+     * Transforms are kept for the lifetime of the process, keyed by the contents of the profile
+     * and the intent, so that documents with many images in the same colour space only create
+     * one. They may be used from several threads at once.
+     */
+    std::shared_ptr<CMSTransform const> get_transform_to_srgb(cmsHPROFILE profile, int intent);
+
     static void do_transform(cmsHTRANSFORM transform, unsigned char *inBuf, unsigned char *outBuf, unsigned size);
 
 private:
@@ -110,6 +132,9 @@ private:
     // Shared immutably with all canvases.
     std::shared_ptr<CMSTransform const> current_transform;
 
+    // Transforms to sRGB by profile ID and intent, see get_transform_to_srgb().
+    std::map<std::pair<std::array<cmsUInt8Number, 16>, int>, std::shared_ptr<CMSTransform const>> srgb_transforms;
+
     // So we can delete them later.
     cmsHPROFILE current_monitor_profile = nullptr;
     cmsHPROFILE current_proof_profile   = nullptr;
@@ -10,19 +10,29 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cmath>
 #include "drawing-group.h"
 #include "cairo-utils.h"
 #include "drawing-context.h"
 #include "drawing-surface.h"
 #include "drawing-text.h"
 #include "drawing.h"
+#include "helper/geom.h"
 #include "style.h"
+#include "ui/widget/canvas/framecheck.h"
 
 namespace Inkscape {
 
 DrawingGroup::DrawingGroup(Drawing &drawing)
     : DrawingItem(drawing) {}
 
+DrawingGroup::~DrawingGroup()
+{
+    if (_instance_key) {
+        _drawing.instanceCache().removeUser(*_instance_key);
+    }
+}
+
 /**
  * Set whether the group returns children from pick calls.
  * Previously this feature was called "transparent groups".
@@ -51,6 +61,31 @@ void DrawingGroup::setChildTransform(Geom::Affine const &transform)
     });
 }
 
+void DrawingGroup::setInstanceKey(std::optional<InstanceKey> key)
+{
+    defer([this, key = std::move(key)] () mutable {
+        if (key == _instance_key) return;
+        auto &cache = _drawing.instanceCache();
+        if (_instance_key) {
+            cache.removeUser(*_instance_key);
+        }
+        _instance_key = std::move(key);
+        if (_instance_key) {
+            cache.addUser(*_instance_key);
+        }
+        _markForRendering();
+    });
+}
+
+void DrawingGroup::_dropInstanceCache()
+{
+    // Called when something below this group changed. Since all instances get the same change,
+    // the renderings made from any of them are out of date.
+    if (_instance_key) {
+        _drawing.instanceCache().drop(*_instance_key);
+    }
+}
+
 unsigned DrawingGroup::_updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset)
 {
     bool outline = _drawing.renderMode() == RenderMode::OUTLINE || _drawing.outlineOverlay();
@@ -76,6 +111,10 @@ unsigned DrawingGroup::_updateItem(Geom::IntRect const &area, UpdateContext cons
 
 unsigned DrawingGroup::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags, DrawingItem const *stop_at) const
 {
+    if (!stop_at && _instance_key && _renderInstance(dc, rc, area, flags)) {
+        return RENDER_OK;
+    }
+
     if (!stop_at) {
         // normal rendering
         for (auto &i : _children) {
@@ -99,6 +138,79 @@ unsigned DrawingGroup::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
     return RENDER_OK;
 }
 
+/**
+ * Paint the children from the rendering shared with the other instances of the same content,
+ * making it first if necessary. Returns false if the children need to be rendered normally.
+ */
+bool DrawingGroup::_renderInstance(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags) const
+{
+    // Content blending with or filtering the background behind it cannot be rendered in isolation.
+    if (!_bbox || _contains_unisolated_blend || _background_accumulate
+        || (flags & (RENDER_OUTLINE | RENDER_FILTER_BACKGROUND | RENDER_BYPASS_CACHE))
+        || _drawing.colorMode() != ColorMode::NORMAL || _drawing.outlineOverlay())
+    {
+        return false;
+    }
+
+    auto &cache = _drawing.instanceCache();
+    if (!cache.isShared(*_instance_key)) {
+        return false;
+    }
+
+    int const device_scale = dc.surface()->device_scale();
+    auto const rect = expandedBy(*_bbox, 1);
+    auto const bytes = std::size_t(rect.width()) * rect.height() * device_scale * device_scale * 4;
+    if (!cache.fits(bytes)) {
+        return false;
+    }
+
+    auto const ctm = _child_transform ? *_child_transform * _ctm : _ctm;
+
+    // Snap the translation to a quarter of a device pixel, so that instances at most positions can
+    // share a rendering that differs from theirs by a whole number of pixels.
+    int constexpr steps = InstanceCache::SUBPIXEL_STEPS;
+    auto const snapped = (ctm.translation() * (device_scale * steps)).round();
+    auto const base = round_down(snapped, {steps, steps});
+
+    auto quantize = [] (double x) { return std::llround(x * 65536.0); };
+    auto const key = InstanceCache::Key{
+        .content = *_instance_key,
+        .linear = { quantize(ctm[0]), quantize(ctm[1]), quantize(ctm[2]), quantize(ctm[3]) },
+        .subpixel = snapped - base,
+        .device_scale = device_scale,
+        .flags = flags
+    };
+
+    auto entry = cache.lookup(key);
+    if (entry) {
+        FrameCheck::count("instance-hit");
+    } else {
+        FrameCheck::count("instance-miss");
+        auto made = std::make_shared<InstanceCache::Entry>(rect, base, device_scale);
+        DrawingContext ict(made->surface->cobj(), rect.min());
+        if (rc.antialiasing_override) {
+            apply_antialias(ict, *rc.antialiasing_override);
+        }
+        ict.translate(Geom::Point(snapped) / (device_scale * steps) - ctm.translation());
+        for (auto &i : _children) {
+            i.render(ict, rc, rect, flags);
+        }
+        made->surface->flush();
+        entry = made;
+        cache.insert(key, std::move(made));
+    }
+
+    auto save = DrawingContext::Save(dc);
+    dc.rectangle(area);
+    dc.clip();
+    auto const origin = Geom::Point(entry->rect.min()) + Geom::Point(base - entry->base) / (device_scale * steps);
+    dc.setSource(entry->surface->cobj(), origin.x(), origin.y());
+    dc.setOperator(CAIRO_OPERATOR_OVER);
+    dc.paint();
+
+    return true;
+}
+
 void DrawingGroup::_clipItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area) const
 {
     for (auto &i : _children) {
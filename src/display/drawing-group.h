@@ -13,7 +13,9 @@
 #ifndef INKSCAPE_DISPLAY_DRAWING_GROUP_H
 #define INKSCAPE_DISPLAY_DRAWING_GROUP_H
 
+#include <optional>
 #include "display/drawing-item.h"
+#include "display/instance-cache.h"
 
 namespace Inkscape {
 
@@ -29,16 +31,27 @@ public:
 
     void setChildTransform(Geom::Affine const &);
 
+    /**
+     * Mark the group as showing the given content. Groups with the same key must have children
+     * that render identically up to their transform, such as the clones of one object; they
+     * then share a single rendering through the Drawing's InstanceCache.
+     */
+    void setInstanceKey(std::optional<InstanceKey> key);
+
 protected:
-    ~DrawingGroup() override = default;
+    ~DrawingGroup() override;
 
     unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset) override;
     unsigned _renderItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags, DrawingItem const *stop_at) const override;
     void _clipItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area) const override;
     DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags) override;
     bool _canClip() const override { return true; }
+    void _dropInstanceCache() override;
+
+    bool _renderInstance(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags) const;
 
     std::unique_ptr<Geom::Affine> _child_transform;
+    std::optional<InstanceKey> _instance_key;
 };
 
 } // namespace Inkscape
@@ -25,6 +25,7 @@
 
 #include "display/control/canvas-item-drawing.h"
 #include "ui/widget/canvas.h" // Mark area for redrawing.
+#include "ui/widget/canvas/framecheck.h"
 
 #include "nr-filter.h"
 #include "style.h"
@@ -276,6 +277,9 @@ void DrawingItem::_setCached(bool cached, bool persistent)
     } else {
         _cache.reset();
         _drawing._cached_items.erase(this);
+        if (_filter) {
+            _filter->drop_cache();
+        }
     }
 }
 
@@ -535,7 +539,8 @@ void DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, un
         if (_cache && _cache->surface) {
             _cache->surface->markDirty();
         }
-        _dropPatternCache();
+        // Pattern tiles are not dropped: they only depend on the transform through their
+        // resolution, which is part of the key they are cached under.
     }
 
     // Decide whether this node should be a totally-invalidating node.
@@ -626,8 +631,11 @@ void DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, un
         bool cacheable = !_contains_unisolated_blend || isolated;
 
         // Determine whether to make this item eligible for caching, by creating a cache iterator.
+        // Filtered items are always eligible: without a cache, every tile they touch has to
+        // evaluate the filter again over its own enlarged area.
+        bool const filtered = _filter && _drawing.renderMode() != RenderMode::NO_FILTERS;
         double score = _cacheScore();
-        if (score >= CACHE_SCORE_THRESHOLD && cacheable) {
+        if ((score >= CACHE_SCORE_THRESHOLD || (filtered && score > 0)) && cacheable) {
             CacheRecord cr;
             cr.score = score;
             // if _cacheRect() is empty, a negative score will be returned from _cacheScore(),
@@ -735,6 +743,9 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
     Geom::OptIntRect iarea = carea;
     // expand carea to contain the dependent area of filters.
     if (forcecache) {
+        // Evaluate the filter over the whole cached region, even when there is no cache to keep
+        // the result in. Blurs below the best quality are subsampled on a grid that depends on the
+        // size of the area rendered, so rendering each tile on its own would leave seams.
         iarea = _cacheRect();
         if (!iarea) {
             iarea = carea;
@@ -748,6 +759,11 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
         return RENDER_OK;
     }
 
+    FrameCheck::Event fc;
+    if (FrameCheck::is_recording()) {
+        fc = FrameCheck::Event(drawingitem_tag_names[tag()], name().raw());
+    }
+
     // Device scale for HiDPI screens (typically 1 or 2)
     int const device_scale = dc.surface()->device_scale();
 
@@ -765,10 +781,13 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
             dc.setOperator(ink_css_blend_to_cairo_operator(_blend_mode));
             _cache->surface->paintFromCache(dc, carea, forcecache);
             if (!carea) {
+                FrameCheck::count("cache-hit");
                 dc.setSource(0, 0, 0, 0);
                 return RENDER_OK;
             }
+            FrameCheck::count("cache-miss");
         } else {
+            FrameCheck::count("cache-miss");
             // There is no cache. This could be because caching of this item
             // was just turned on after the last update phase, or because
             // we were previously outside of the canvas.
@@ -1112,7 +1131,14 @@ void DrawingItem::_markForRendering()
 {
     bool outline = _drawing.renderMode() == RenderMode::OUTLINE || _drawing.outlineOverlay();
     Geom::OptIntRect dirty = outline ? _bbox : _drawbox;
-    if (!dirty) return;
+    if (!dirty) {
+        // Nothing to redraw, but renderings of the content above may still be out of date.
+        for (auto i = _parent; i; i = i->_parent) {
+            i->_dropPatternCache();
+            i->_dropInstanceCache();
+        }
+        return;
+    }
 
     // dirty the caches of all parents
     DrawingItem *bkg_root = nullptr;
@@ -1124,7 +1150,11 @@ void DrawingItem::_markForRendering()
         if (i->_cache && i->_cache->surface) {
             i->_cache->surface->markDirty(*dirty);
         }
-        i->_dropPatternCache();
+        if (i != this) {
+            // The content of these changed, not just where they are or how they are painted.
+            i->_dropPatternCache();
+            i->_dropInstanceCache();
+        }
         if (i->_background_accumulate) {
             bkg_root = i;
         }
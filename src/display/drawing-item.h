@@ -195,6 +195,7 @@ protected:
     virtual DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags) { return nullptr; }
     virtual bool _canClip() const { return false; }
     virtual void _dropPatternCache() {}
+    virtual void _dropInstanceCache() {}
 
     Drawing &_drawing;
     DrawingItem *_parent;
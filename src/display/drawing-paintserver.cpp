@@ -1,5 +1,11 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 #include "drawing-paintserver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <2geom/transforms.h>
+
 #include "cairo-utils.h"
 
 namespace Inkscape {
@@ -109,12 +115,32 @@ cairo_pattern_t *DrawingRadialGradient::create_pattern(cairo_t *ct, Geom::OptRec
     return pat;
 }
 
-cairo_pattern_t *DrawingMeshGradient::create_pattern(cairo_t *, Geom::OptRect const &bbox, double opacity) const
+namespace {
+
+/// Rasters of a mesh are made at scales rounded up to a quarter power of two, so that they are
+/// shared across small changes in zoom while never being magnified by more than 2^(1/4).
+double bucket_scale(double scale)
 {
-#ifdef MESH_DEBUG
-    std::cout << "sp_meshgradient_create_pattern: " << bbox << " " << opacity << std::endl;
-#endif
+    return std::exp2(std::ceil(std::log2(scale) * 4) / 4);
+}
+
+/// Above this size, a raster is not worth its memory, and the mesh is painted directly instead.
+constexpr std::size_t MAX_RASTER_PIXELS = 2048 * 2048;
+
+/// Number of rasters kept for each mesh, for instance when it is shown at several zoom levels.
+constexpr std::size_t MAX_RASTERS = 3;
 
+} // namespace
+
+DrawingMeshGradient::~DrawingMeshGradient()
+{
+    for (auto &raster : rasters) {
+        cairo_surface_destroy(raster.surface);
+    }
+}
+
+cairo_pattern_t *DrawingMeshGradient::create_mesh_pattern(double opacity) const
+{
     auto pat = cairo_pattern_create_mesh();
 
     for (int i = 0; i < rows; i++) {
@@ -159,12 +185,110 @@ cairo_pattern_t *DrawingMeshGradient::create_pattern(cairo_t *, Geom::OptRect co
         }
     }
 
+    return pat;
+}
+
+Geom::OptRect DrawingMeshGradient::mesh_bounds() const
+{
+    Geom::OptRect bounds;
+    for (auto const &row : patchdata) {
+        for (auto const &data : row) {
+            for (int k = 0; k < 4; k++) {
+                for (auto const &p : data.points[k]) {
+                    bounds.expandTo(p);
+                }
+                if (data.tensorIsSet[k]) {
+                    bounds.expandTo(data.tensorpoints[k]);
+                }
+            }
+        }
+    }
+    return bounds;
+}
+
+auto DrawingMeshGradient::get_raster(double sx, double sy, double opacity) const -> std::optional<Raster>
+{
+    auto lock = std::lock_guard(mutex);
+
+    for (auto it = rasters.begin(); it != rasters.end(); ++it) {
+        if (it->sx == sx && it->sy == sy && it->opacity == opacity) {
+            std::rotate(rasters.begin(), it, it + 1);
+            auto result = rasters.front();
+            cairo_surface_reference(result.surface);
+            return result;
+        }
+    }
+
+    auto const bounds = mesh_bounds();
+    if (!bounds) {
+        return {};
+    }
+
+    // Leave a transparent pixel on each side, so that sampling fades out at the edges.
+    auto const origin = Geom::Point(std::floor(bounds->left() * sx) - 1, std::floor(bounds->top() * sy) - 1);
+    auto const width = std::ceil(bounds->right() * sx) + 1 - origin.x();
+    auto const height = std::ceil(bounds->bottom() * sy) + 1 - origin.y();
+    if (!(width * height <= MAX_RASTER_PIXELS)) {
+        return {};
+    }
+
+    auto surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    auto ct = cairo_create(surface);
+    cairo_translate(ct, -origin.x(), -origin.y());
+    cairo_scale(ct, sx, sy);
+    auto pat = create_mesh_pattern(opacity);
+    cairo_set_source(ct, pat);
+    cairo_paint(ct);
+    cairo_pattern_destroy(pat);
+    cairo_destroy(ct);
+    cairo_surface_flush(surface);
+
+    if (rasters.size() >= MAX_RASTERS) {
+        cairo_surface_destroy(rasters.back().surface);
+        rasters.pop_back();
+    }
+    rasters.insert(rasters.begin(), {sx, sy, opacity, origin, surface});
+    cairo_surface_reference(surface);
+    return rasters.front();
+}
+
+cairo_pattern_t *DrawingMeshGradient::create_pattern(cairo_t *ct, Geom::OptRect const &bbox, double opacity) const
+{
+#ifdef MESH_DEBUG
+    std::cout << "sp_meshgradient_create_pattern: " << bbox << " " << opacity << std::endl;
+#endif
+
     // set pattern transform matrix
     Geom::Affine gs2user = transform;
     if (units == SP_GRADIENT_UNITS_OBJECTBOUNDINGBOX && bbox) {
         Geom::Affine bbox2user(bbox->width(), 0, 0, bbox->height(), bbox->left(), bbox->top());
         gs2user *= bbox2user;
     }
+
+    // Subdividing the patches is by far the slowest part of painting a mesh, and Cairo does it
+    // again for every tile. On image surfaces, sample a raster of the whole mesh instead, made at
+    // about the device resolution. Vector surfaces must keep the mesh itself.
+    if (ct && cairo_surface_get_type(cairo_get_target(ct)) == CAIRO_SURFACE_TYPE_IMAGE) {
+        // Device pixels per unit along each axis of gradient space.
+        double xx = gs2user[0], xy = gs2user[1];
+        double yx = gs2user[2], yy = gs2user[3];
+        cairo_user_to_device_distance(ct, &xx, &xy);
+        cairo_user_to_device_distance(ct, &yx, &yy);
+        auto const sx = std::hypot(xx, xy);
+        auto const sy = std::hypot(yx, yy);
+
+        if (sx > 0 && sy > 0 && std::isfinite(sx) && std::isfinite(sy)) {
+            if (auto raster = get_raster(bucket_scale(sx), bucket_scale(sy), opacity)) {
+                auto pat = cairo_pattern_create_for_surface(raster->surface);
+                cairo_surface_destroy(raster->surface);
+                auto const gs2raster = Geom::Scale(raster->sx, raster->sy) * Geom::Translate(-raster->origin);
+                ink_cairo_pattern_set_matrix(pat, gs2user.inverse() * gs2raster);
+                return pat;
+            }
+        }
+    }
+
+    auto pat = create_mesh_pattern(opacity);
     ink_cairo_pattern_set_matrix(pat, gs2user.inverse());
 
     return pat;
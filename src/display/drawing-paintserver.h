@@ -12,6 +12,8 @@
  */
 
 #include <array>
+#include <mutex>
+#include <optional>
 #include <vector>
 #include <cairo.h>
 #include <2geom/rect.h>
@@ -163,12 +165,36 @@ public:
         , cols(cols)
         , patchdata(std::move(patchdata)) {}
 
-    cairo_pattern_t *create_pattern(cairo_t*, Geom::OptRect const &bbox, double opacity) const override;
+    ~DrawingMeshGradient() override;
+
+    /**
+     * When painting to an image surface, return a pattern sampling a raster of the mesh made once
+     * per zoom level and shared between all calls. Otherwise, such as for PDF output, return the
+     * Cairo mesh pattern itself.
+     */
+    cairo_pattern_t *create_pattern(cairo_t *ct, Geom::OptRect const &bbox, double opacity) const override;
 
 private:
     int rows;
     int cols;
     std::vector<std::vector<PatchData>> patchdata;
+
+    /// A rasterisation of the mesh in gradient space, scaled by (sx, sy) and offset by origin.
+    struct Raster
+    {
+        double sx, sy;
+        double opacity;
+        Geom::Point origin;
+        cairo_surface_t *surface;
+    };
+
+    mutable std::mutex mutex;
+    mutable std::vector<Raster> rasters; ///< Most recently used first.
+
+    cairo_pattern_t *create_mesh_pattern(double opacity) const;
+    Geom::OptRect mesh_bounds() const;
+    /// Return the raster for the given scale and opacity, making it if necessary. The caller owns a reference to the surface.
+    std::optional<Raster> get_raster(double sx, double sy, double opacity) const;
 };
 
 } // namespace Inkscape
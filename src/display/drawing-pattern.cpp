@@ -10,6 +10,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cmath>
 #include <cairomm/region.h>
 #include <cairo.h>
 #include "cairo-utils.h"
@@ -23,19 +24,29 @@
 
 namespace Inkscape {
 
-DrawingPattern::Surface::Surface(Geom::IntRect const &rect, int device_scale)
-    : rect(rect)
-    , surface(Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, rect.width() * device_scale, rect.height() * device_scale))
-{
-    cairo_surface_set_device_scale(surface->cobj(), device_scale, device_scale);
-}
-
 DrawingPattern::DrawingPattern(Drawing &drawing)
     : DrawingGroup(drawing)
     , _overflow_steps(1)
 {
 }
 
+DrawingPattern::~DrawingPattern()
+{
+    // Even shared tiles are dropped, since the content may be freed along with this pattern, and
+    // another object allocated at its address would otherwise be shown with its tiles.
+    _dropPatternCache();
+}
+
+void DrawingPattern::setContent(void const *content)
+{
+    defer([=] {
+        if (content == _content) return;
+        _dropPatternCache(); // As in the destructor, the old content may be about to be freed.
+        _content = content;
+        _markForRendering();
+    });
+}
+
 void DrawingPattern::setPatternToUserTransform(Geom::Affine const &transform)
 {
     defer([=] {
@@ -128,7 +139,7 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
     };
 
     // Paint the periodic tiling of a into b, and remove the painted region from dirty.
-    auto wrapped_paint = [&, this] (Surface const &a, Geom::IntRect &b, Cairo::RefPtr<Cairo::Context> const &cr, Cairo::RefPtr<Cairo::Region> const &dirty) {
+    auto wrapped_paint = [&, this] (PatternCache::Surface const &a, Geom::IntRect &b, Cairo::RefPtr<Cairo::Context> const &cr, Cairo::RefPtr<Cairo::Region> const &dirty) {
         auto const [min, max] = overlapping_translates(a.rect, b);
         for (int x = min.x(); x <= max.x(); x += _pattern_resolution.x()) {
             for (int y = min.y(); y <= max.y(); y += _pattern_resolution.y()) {
@@ -144,11 +155,23 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
     auto const area_orig = (Geom::Rect(area) * screen_to_tile).roundOutwards();
     auto const area_tile = canonicalised(area_orig);
 
-    // Simplest solution for now to protecting pattern cache is a mutex. This makes all
-    // pattern rendering single-threaded, however patterns are typically not the bottleneck.
-    auto lock = std::lock_guard(mutables);
+    // Get the tiles, shared with all other patterns showing the same content in the same way.
+    auto &cache = _drawing.patternCache();
+    auto const key = PatternCache::Key{
+        .content = _contentKey(),
+        .params = _params,
+        .device_scale = device_scale,
+        .antialias = rc.antialiasing_override ? static_cast<int>(*rc.antialiasing_override) : -1
+    };
+    auto const tiles = cache.get(key);
+    auto &surfaces = tiles->surfaces;
+
+    // Simplest solution for now to protecting the tiles is a mutex. This makes rendering of each
+    // pattern single-threaded, however patterns are typically not the bottleneck. It also means
+    // that users of the same tile wait for it to be rendered once, rather than all rendering it.
+    auto lock = std::lock_guard(tiles->mutex);
 
-    auto get_surface = [&, this] () -> std::pair<Surface*, Cairo::RefPtr<Cairo::Region>> {
+    auto get_surface = [&, this] () -> std::pair<PatternCache::Surface*, Cairo::RefPtr<Cairo::Region>> {
         // If there is a rectangle containing the requested area, just use that.
         for (auto &s : surfaces) {
             if (wrapped_contains(s.rect, area_tile)) {
@@ -157,7 +180,7 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
         }
 
         // Otherwise, recursively merge the requested area with all overlapping or touching rectangles, and paint the missing part.
-        std::vector<Surface> merged;
+        std::vector<PatternCache::Surface> merged;
         auto expanded = area_tile;
 
         while (true) {
@@ -182,7 +205,7 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
         expanded = canonicalised(expanded);
 
         // Create a new surface covering the expanded rectangle.
-        auto surface = Surface(expanded, device_scale);
+        auto surface = PatternCache::Surface(expanded, device_scale);
         auto cr = Cairo::Context::create(surface.surface);
         cr->translate(-surface.rect.left(), -surface.rect.top());
 
@@ -252,6 +275,7 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
             }
         }
         dirty.clear();
+        cache.setSize(key, tiles->size());
     }
 
     // Debug: Show pattern tile.
@@ -270,8 +294,6 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
 
 unsigned DrawingPattern::_updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset)
 {
-    _dropPatternCache();
-
     if (!_tile_rect || _tile_rect->hasZeroArea()) {
         return STATE_NONE;
     }
@@ -280,6 +302,9 @@ unsigned DrawingPattern::_updateItem(Geom::IntRect const &area, UpdateContext co
     double const det_ctm = ctx.ctm.det();
     double const det_ps2user = _pattern_to_user ? _pattern_to_user->det() : 1.0;
     double scale = std::sqrt(std::abs(det_ctm * det_ps2user));
+    // Round up to a quarter power of two, so that rendered tiles remain valid over a range of zoom
+    // levels, at the cost of rendering them at most 19% larger than needed.
+    scale = std::exp2(std::ceil(std::log2(scale) * 4.0) / 4.0);
     // Fixme: When scale is too big (zooming in a pattern), Cairo doesn't render the pattern.
     // More precisely it fails when setting pattern matrix in DrawingPattern::renderPattern.
     // Correct solution should make use of visible area and change pattern tile rect accordingly.
@@ -289,13 +314,33 @@ unsigned DrawingPattern::_updateItem(Geom::IntRect const &area, UpdateContext co
     // Map tile rect to the origin and stretch it to the desired resolution.
     auto const dt = Geom::Translate(-_tile_rect->min()) * Geom::Scale(_pattern_resolution / _tile_rect->dimensions());
 
+    // Everything that determines the pixels of the tile, apart from its content.
+    _params = {
+        .tile_rect = *_tile_rect,
+        .child_transform = _child_transform ? *_child_transform : Geom::identity(),
+        .resolution = _pattern_resolution,
+        .overflow_initial_transform = _overflow_initial_transform,
+        .overflow_step_transform = _overflow_step_transform,
+        .overflow_steps = _overflow_steps,
+        .opacity = _opacity,
+        .antialias = static_cast<int>(_antialias),
+        .blend_mode = static_cast<int>(_blend_mode),
+        .isolation = _isolation
+    };
+
     // Apply this transform to the actual pattern tree.
     return DrawingGroup::_updateItem(Geom::IntRect::infinite(), { dt }, flags, reset);
 }
 
 void DrawingPattern::_dropPatternCache()
 {
-    surfaces.clear();
+    // Called when the content changed; the tiles of every pattern showing it are out of date.
+    _drawing.patternCache().drop(_contentKey());
+}
+
+std::uintptr_t DrawingPattern::_contentKey() const
+{
+    return reinterpret_cast<std::uintptr_t>(_content ? _content : this);
 }
 
 } // namespace Inkscape
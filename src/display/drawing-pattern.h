@@ -13,9 +13,8 @@
 #ifndef INKSCAPE_DISPLAY_DRAWING_PATTERN_H
 #define INKSCAPE_DISPLAY_DRAWING_PATTERN_H
 
-#include <mutex>
-#include <cairomm/surface.h>
 #include "drawing-group.h"
+#include "pattern-cache.h"
 
 using cairo_pattern_t = struct _cairo_pattern;
 
@@ -62,12 +61,19 @@ public:
      */
     cairo_pattern_t *renderPattern(RenderContext &rc, Geom::IntRect const &area, float opacity, int device_scale) const;
 
+    /**
+     * Set the object providing the content of the tile. Patterns with the same content and tile
+     * parameters share their rendered tiles; without content they keep their own.
+     */
+    void setContent(void const *content);
+
 protected:
-    ~DrawingPattern() override = default;
+    ~DrawingPattern() override;
 
     unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset) override;
 
     void _dropPatternCache() override;
+    std::uintptr_t _contentKey() const;
 
     std::unique_ptr<Geom::Affine> _pattern_to_user;
 
@@ -80,18 +86,10 @@ protected:
 
     // Set on update.
     Geom::IntPoint _pattern_resolution;
+    PatternCache::Params _params;
 
-    struct Surface
-    {
-        Surface(Geom::IntRect const &rect, int device_scale);
-        Geom::IntRect rect;
-        Cairo::RefPtr<Cairo::ImageSurface> surface;
-    };
-
-    mutable std::mutex mutables;
-
-    // Parts of the pattern tile that have been rendered. Read/written on render, cleared on update.
-    mutable std::vector<Surface> surfaces;
+    // Identifies the content of the tile, for sharing it through the PatternCache.
+    void const *_content = nullptr;
 };
 
 } // namespace Inkscape
@@ -12,11 +12,12 @@
  */
 
 #include <array>
-#include <thread>
 #include "display/drawing.h"
 #include "display/control/canvas-item-drawing.h"
+#include "ui/widget/canvas/framecheck.h"
 #include "nr-filter-gaussian.h"
 #include "nr-filter-types.h"
+#include "util/worker-pool.h"
 
 // Grayscale colormode
 #include "cairo-templates.h"
@@ -42,12 +43,6 @@ static auto rendermode_to_renderflags(RenderMode mode)
     }
 }
 
-static auto default_numthreads()
-{
-    auto ret = std::thread::hardware_concurrency();
-    return ret == 0 ? 4 : ret; // Sensible fallback if not reported.
-}
-
 Drawing::Drawing(Inkscape::CanvasItemDrawing *canvas_item_drawing)
     : _canvas_item_drawing(canvas_item_drawing)
     , _grayscale_matrix(std::vector<double>(grayscale_matrix.begin(), grayscale_matrix.end()))
@@ -226,6 +221,11 @@ void Drawing::setAntialiasingOverride(std::optional<Antialiasing> antialiasing_o
 
 void Drawing::update(Geom::IntRect const &area, Geom::Affine const &affine, unsigned flags, unsigned reset)
 {
+    FrameCheck::Event fc;
+    if (FrameCheck::is_recording()) {
+        fc = FrameCheck::Event("Drawing::update");
+    }
+
     if (_root) {
         _root->update(area, { affine }, flags, reset);
     }
@@ -311,6 +311,8 @@ void Drawing::_clearCache()
     for (auto item : to_uncache) {
         item->_setCached(false, true);
     }
+    _instance_cache.clear();
+    _pattern_cache.clear();
 }
 
 void Drawing::_loadPrefs()
@@ -337,7 +339,10 @@ void Drawing::_loadPrefs()
     }
 
     // Set the global variable governing the number of filter threads, and track it too. (This is ugly, but hopefully transitional.)
-    set_num_filter_threads(prefs->getIntLimited("/options/threading/numthreads", default_numthreads(), 1, 256));
+    // The shared worker pool that all rendering runs in gets the same number of threads.
+    auto const numthreads = prefs->getIntLimited("/options/threading/numthreads", Util::default_numthreads(), 1, 256);
+    set_num_filter_threads(numthreads);
+    Util::WorkerPool::set_size(numthreads);
 
     // Similarly, enable preference tracking only for the Canvas's drawing.
     if (_canvas_item_drawing) {
@@ -354,7 +359,7 @@ void Drawing::_loadPrefs()
         actions.emplace("/options/cursortolerance/value",        [this] (auto &entry) { setCursorTolerance(entry.getDouble(1.0)); });
         actions.emplace("/options/selection/zeroopacity",        [this] (auto &entry) { setSelectZeroOpacity(entry.getBool(false)); });
         actions.emplace("/options/renderingcache/size",          [this] (auto &entry) { setCacheBudget((1 << 20) * entry.getIntLimited(64, 0, 4096)); });
-        actions.emplace("/options/threading/numthreads",         [this] (auto &entry) { set_num_filter_threads(entry.getIntLimited(default_numthreads(), 1, 256)); });
+        actions.emplace("/options/threading/numthreads",         [this] (auto &entry) { auto const n = entry.getIntLimited(Util::default_numthreads(), 1, 256); set_num_filter_threads(n); Util::WorkerPool::set_size(n); });
 
         _pref_tracker = Inkscape::Preferences::PreferencesObserver::create("/options", [actions = std::move(actions)] (auto &entry) {
             auto it = actions.find(entry.getPath());
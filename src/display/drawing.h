@@ -23,6 +23,8 @@
 #include <sigc++/sigc++.h>
 
 #include "display/drawing-item.h"
+#include "display/instance-cache.h"
+#include "display/pattern-cache.h"
 #include "display/rendermode.h"
 #include "nr-filter-colormatrix.h"
 #include "preferences.h"
@@ -78,6 +80,8 @@ public:
     double cursorTolerance() const { return _cursor_tolerance; }
     bool selectZeroOpacity() const { return _select_zero_opacity; }
     Geom::OptIntRect const &cacheLimit() const { return _cache_limit; }
+    InstanceCache &instanceCache() { return _instance_cache; }
+    PatternCache &patternCache() { return _pattern_cache; }
 
     void update(Geom::IntRect const &area = Geom::IntRect::infinite(), Geom::Affine const &affine = Geom::identity(),
                 unsigned flags = DrawingItem::STATE_ALL, unsigned reset = 0);
@@ -122,6 +126,8 @@ private:
 
     std::set<DrawingItem*> _cached_items; // modified by DrawingItem::_setCached()
     CacheList _candidate_items;           // keep this list always sorted with std::greater
+    InstanceCache _instance_cache;        // renderings shared by clones, see DrawingGroup::setInstanceKey()
+    PatternCache _pattern_cache;          // tiles shared by patterns, see DrawingPattern::setContent()
 
     /*
      * Simple cacheline separator compatible with x86 (64 bytes) and M* (128 bytes).
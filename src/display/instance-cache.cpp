@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Renderings shared between instances of the same content.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "instance-cache.h"
+
+#include <boost/functional/hash.hpp>
+
+namespace Inkscape {
+
+bool InstanceCache::Key::operator==(Key const &other) const
+{
+    return content == other.content
+        && linear == other.linear
+        && subpixel == other.subpixel
+        && device_scale == other.device_scale
+        && flags == other.flags;
+}
+
+std::size_t InstanceCache::ContentHash::operator()(InstanceKey const &content) const
+{
+    std::size_t seed = std::hash<SPItem const *>()(content.original);
+    boost::hash_combine(seed, content.style);
+    boost::hash_combine(seed, content.viewport.x());
+    boost::hash_combine(seed, content.viewport.y());
+    return seed;
+}
+
+std::size_t InstanceCache::KeyHash::operator()(Key const &key) const
+{
+    std::size_t seed = ContentHash()(key.content);
+    for (auto c : key.linear) {
+        boost::hash_combine(seed, c);
+    }
+    boost::hash_combine(seed, key.subpixel.x());
+    boost::hash_combine(seed, key.subpixel.y());
+    boost::hash_combine(seed, key.device_scale);
+    boost::hash_combine(seed, key.flags);
+    return seed;
+}
+
+InstanceCache::Entry::Entry(Geom::IntRect const &rect, Geom::IntPoint const &base, int device_scale)
+    : rect(rect)
+    , base(base)
+    , surface(Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, rect.width() * device_scale, rect.height() * device_scale))
+{
+    cairo_surface_set_device_scale(surface->cobj(), device_scale, device_scale);
+}
+
+std::size_t InstanceCache::Entry::size() const
+{
+    return static_cast<std::size_t>(surface->get_stride()) * surface->get_height();
+}
+
+void InstanceCache::addUser(InstanceKey const &content)
+{
+    auto lock = std::lock_guard(_mutex);
+    _contents[content].users++;
+}
+
+void InstanceCache::removeUser(InstanceKey const &content)
+{
+    auto lock = std::lock_guard(_mutex);
+    auto it = _contents.find(content);
+    if (it == _contents.end() || --it->second.users > 0) {
+        return;
+    }
+    _drop(content);
+    _contents.erase(it);
+}
+
+bool InstanceCache::isShared(InstanceKey const &content) const
+{
+    auto lock = std::lock_guard(_mutex);
+    auto it = _contents.find(content);
+    return it != _contents.end() && it->second.users >= 2;
+}
+
+std::shared_ptr<InstanceCache::Entry const> InstanceCache::lookup(Key const &key)
+{
+    auto lock = std::lock_guard(_mutex);
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        return {};
+    }
+    _records.splice(_records.begin(), _records, it->second);
+    return it->second->entry;
+}
+
+void InstanceCache::insert(Key const &key, std::shared_ptr<Entry const> entry)
+{
+    auto lock = std::lock_guard(_mutex);
+    auto content = _contents.find(key.content);
+    if (content == _contents.end() || _index.count(key)) {
+        // Content was dropped while rendering, or another thread got there first.
+        return;
+    }
+    _size += entry->size();
+    _records.push_front({key, std::move(entry)});
+    _index.emplace(key, _records.begin());
+    content->second.entries++;
+    _evict();
+}
+
+void InstanceCache::drop(InstanceKey const &content)
+{
+    auto lock = std::lock_guard(_mutex);
+    _drop(content);
+}
+
+void InstanceCache::clear()
+{
+    auto lock = std::lock_guard(_mutex);
+    _records.clear();
+    _index.clear();
+    for (auto &[key, content] : _contents) {
+        content.entries = 0;
+    }
+    _size = 0;
+}
+
+void InstanceCache::_drop(InstanceKey const &content)
+{
+    auto it = _contents.find(content);
+    if (it == _contents.end()) {
+        return;
+    }
+    for (auto r = _records.begin(); r != _records.end() && it->second.entries > 0; ) {
+        auto next = std::next(r);
+        if (r->key.content == content) {
+            _erase(r);
+        }
+        r = next;
+    }
+}
+
+void InstanceCache::_erase(std::list<Record>::iterator it)
+{
+    _size -= it->entry->size();
+    _contents[it->key.content].entries--;
+    _index.erase(it->key);
+    _records.erase(it);
+}
+
+void InstanceCache::_evict()
+{
+    while (_size > _budget && !_records.empty()) {
+        _erase(std::prev(_records.end()));
+    }
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Renderings shared between instances of the same content.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef INKSCAPE_DISPLAY_INSTANCE_CACHE_H
+#define INKSCAPE_DISPLAY_INSTANCE_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <cairomm/surface.h>
+#include <2geom/int-point.h>
+#include <2geom/int-rect.h>
+#include <2geom/point.h>
+
+class SPItem;
+
+namespace Inkscape {
+
+/**
+ * What instances display, apart from their position: the object their content is made from, the
+ * style it inherits, and the size of the viewport it is fitted into, if it has one.
+ */
+struct InstanceKey
+{
+    SPItem const *original;
+    std::string style;
+    Geom::Point viewport;
+
+    bool operator==(InstanceKey const &other) const = default;
+};
+
+/**
+ * @brief Rendered content of DrawingGroups that display the same thing in different places.
+ *
+ * Clones of the same object have identical subtrees that differ only by their position. Groups
+ * showing such a subtree are given the same content key (see DrawingGroup::setInstanceKey()),
+ * and whenever at least two of them exist, the first one to be rendered stores its rendering
+ * here for the others to paint as a single image.
+ *
+ * Renderings are looked up by content key, the linear part of the transform, the sub-pixel part
+ * of the translation (snapped to a quarter pixel) and the render flags, and are kept in
+ * least-recently-used order within a fixed memory budget.
+ */
+class InstanceCache
+{
+public:
+    struct Key
+    {
+        InstanceKey content;
+        std::array<std::int64_t, 4> linear; ///< Linear part of the transform, in fixed point.
+        Geom::IntPoint subpixel;            ///< Sub-pixel part of the translation, in SUBPIXEL_STEPS.
+        int device_scale;
+        unsigned flags;
+
+        bool operator==(Key const &other) const;
+    };
+
+    struct Entry
+    {
+        Entry(Geom::IntRect const &rect, Geom::IntPoint const &base, int device_scale);
+        Geom::IntRect rect;   ///< Area covered by the surface, in logical pixels.
+        Geom::IntPoint base;  ///< Whole-pixel part of the translation it was rendered with, in SUBPIXEL_STEPS per device pixel.
+        Cairo::RefPtr<Cairo::ImageSurface> surface;
+
+        std::size_t size() const;
+    };
+
+    /// Number of quarter-pixel steps the translation is snapped to.
+    static int constexpr SUBPIXEL_STEPS = 4;
+
+    InstanceCache() = default;
+    InstanceCache(InstanceCache const &) = delete;
+    InstanceCache &operator=(InstanceCache const &) = delete;
+
+    void addUser(InstanceKey const &content);
+    void removeUser(InstanceKey const &content);
+    bool isShared(InstanceKey const &content) const;
+
+    std::shared_ptr<Entry const> lookup(Key const &key);
+    void insert(Key const &key, std::shared_ptr<Entry const> entry);
+    bool fits(std::size_t bytes) const { return bytes <= _budget / 8; }
+
+    void drop(InstanceKey const &content);
+    void clear();
+
+private:
+    struct ContentHash
+    {
+        std::size_t operator()(InstanceKey const &content) const;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(Key const &key) const;
+    };
+
+    struct Record
+    {
+        Key key;
+        std::shared_ptr<Entry const> entry;
+    };
+
+    struct Content
+    {
+        int users = 0;
+        int entries = 0;
+    };
+
+    void _drop(InstanceKey const &content);
+    void _erase(std::list<Record>::iterator it);
+    void _evict();
+
+    mutable std::mutex _mutex;
+    std::list<Record> _records; ///< Most recently used first.
+    std::unordered_map<Key, std::list<Record>::iterator, KeyHash> _index;
+    std::unordered_map<InstanceKey, Content, ContentHash> _contents;
+    std::size_t _size = 0;
+    std::size_t _budget = std::size_t{64} << 20;
+};
+
+} // namespace Inkscape
+
+#endif // INKSCAPE_DISPLAY_INSTANCE_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
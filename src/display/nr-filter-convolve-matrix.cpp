@@ -11,6 +11,8 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cmath>
+#include <optional>
 #include <vector>
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
@@ -97,6 +99,190 @@ private:
     double _bias;
 };
 
+/// A kernel written as a sum of outer products of a column and a row vector.
+struct KernelTerms
+{
+    std::vector<std::vector<double>> cols; ///< orderY elements each
+    std::vector<std::vector<double>> rows; ///< orderX elements each
+};
+
+/**
+ * Split a kernel into a sum of separable terms, by repeatedly subtracting the outer product
+ * through the largest remaining element. Gives up once the terms would cost as much as
+ * applying the kernel directly, so in practice this finds separable and rank 2 or 3 kernels.
+ */
+static std::optional<KernelTerms> decompose_kernel(std::vector<double> kernel, int orderX, int orderY)
+{
+    double max_abs = 0.0;
+    for (auto k : kernel) {
+        max_abs = std::max(max_abs, std::abs(k));
+    }
+    double const eps = max_abs * 1e-9;
+
+    KernelTerms terms;
+    while (true) {
+        auto pivot = std::max_element(kernel.begin(), kernel.end(),
+                                      [] (double a, double b) { return std::abs(a) < std::abs(b); });
+        if (std::abs(*pivot) <= eps) {
+            return terms;
+        }
+        if ((terms.rows.size() + 1) * (orderX + orderY) >= (std::size_t)(orderX * orderY)) {
+            return {};
+        }
+
+        int const pi = (pivot - kernel.begin()) / orderX;
+        int const pj = (pivot - kernel.begin()) % orderX;
+        std::vector<double> col(orderY), row(orderX);
+        for (int i = 0; i < orderY; ++i) {
+            col[i] = kernel[i * orderX + pj] / *pivot;
+        }
+        for (int j = 0; j < orderX; ++j) {
+            row[j] = kernel[pi * orderX + j];
+        }
+        for (int i = 0; i < orderY; ++i) {
+            for (int j = 0; j < orderX; ++j) {
+                kernel[i * orderX + j] -= col[i] * row[j];
+            }
+        }
+        terms.cols.push_back(std::move(col));
+        terms.rows.push_back(std::move(row));
+    }
+}
+
+/**
+ * Applies a kernel given as a sum of separable terms, with a horizontal pass over each row
+ * followed by a vertical pass over the results. Gives the same result as ConvolveMatrix,
+ * including its handling of the edges, in O(orderX + orderY) per pixel and term.
+ */
+template <PreserveAlphaMode preserve_alpha>
+struct SeparableConvolveMatrix : public SurfaceSynth
+{
+    static constexpr int CHANNELS = preserve_alpha == PRESERVE_ALPHA ? 3 : 4;
+
+    SeparableConvolveMatrix(cairo_surface_t *s, int targetX, int targetY, int orderX, int orderY,
+                            double bias, KernelTerms terms)
+        : SurfaceSynth(s)
+        , _terms(std::move(terms))
+        , _targetX(targetX)
+        , _targetY(targetY)
+        , _orderX(orderX)
+        , _orderY(orderY)
+        , _bias(bias)
+    {}
+
+    void render(cairo_surface_t *out) const
+    {
+        int strideout = cairo_image_surface_get_stride(out);
+        int bppout = cairo_image_surface_get_format(out) == CAIRO_FORMAT_A8 ? 1 : 4;
+        unsigned char *out_data = cairo_image_surface_get_data(out);
+
+        // Each band of rows keeps the horizontal pass of the last orderY rows in a ring buffer.
+        int limit = _w * _h;
+        int bands = limit > PARALLEL_THRESHOLD ? get_num_filter_threads() : 1;
+        int band_height = (_h + bands - 1) / bands;
+
+        ink_parallel_for(bands, bands > 1, [&] (int band) {
+            int nterms = _terms.rows.size();
+            std::vector<double> line(CHANNELS * _w);
+            std::vector<double> ring(_orderY * nterms * CHANNELS * _w);
+            auto const ring_row = [&] (int y, int k) {
+                return ring.data() + ((y % _orderY) * nterms + k) * CHANNELS * _w;
+            };
+
+            int next = 0;
+            int end = std::min(_h, (band + 1) * band_height);
+            for (int y = band * band_height; y < end; ++y) {
+                int starty = std::max(0, y - _targetY);
+                int endy = std::min(_h, starty + _orderY);
+
+                for (int yy = std::max(next, starty); yy < endy; ++yy) {
+                    _filterRow(yy, line, [&] (int k) { return ring_row(yy, k); });
+                }
+                next = std::max(next, endy);
+
+                for (int x = 0; x < _w; ++x) {
+                    double sum[4] = {};
+                    for (int k = 0; k < nterms; ++k) {
+                        auto const &col = _terms.cols[k];
+                        for (int i = 0; i < endy - starty; ++i) {
+                            double const *h = ring_row(starty + i, k) + x;
+                            for (int c = 0; c < CHANNELS; ++c) {
+                                sum[c] += col[i] * h[c * _w];
+                            }
+                        }
+                    }
+
+                    double suma;
+                    if (preserve_alpha == PRESERVE_ALPHA) {
+                        suma = alphaAt(x, y);
+                    } else {
+                        suma = sum[3] + _bias * 255;
+                    }
+
+                    guint32 ao = pxclamp(round(suma), 0, 255);
+                    guint32 ro = pxclamp(round(sum[0] + ao * _bias), 0, ao);
+                    guint32 go = pxclamp(round(sum[1] + ao * _bias), 0, ao);
+                    guint32 bo = pxclamp(round(sum[2] + ao * _bias), 0, ao);
+                    if (bppout == 4) {
+                        ASSEMBLE_ARGB32(pxout, ao,ro,go,bo);
+                        reinterpret_cast<guint32 *>(out_data + y * strideout)[x] = pxout;
+                    } else {
+                        out_data[y * strideout + x] = ao;
+                    }
+                }
+            }
+        });
+        cairo_surface_mark_dirty(out);
+    }
+
+private:
+    /// Run the horizontal pass of every term over row y, writing each channel as its own line.
+    template <typename Dest>
+    void _filterRow(int y, std::vector<double> &line, Dest dest) const
+    {
+        for (int x = 0; x < _w; ++x) {
+            EXTRACT_ARGB32(pixelAt(x, y), a,r,g,b)
+            line[x] = r;
+            line[_w + x] = g;
+            line[2 * _w + x] = b;
+            if (CHANNELS == 4) {
+                line[3 * _w + x] = a;
+            }
+        }
+
+        for (std::size_t k = 0; k < _terms.rows.size(); ++k) {
+            auto const &row = _terms.rows[k];
+            double *out = dest(k);
+            for (int x = 0; x < _w; ++x) {
+                int startx = std::max(0, x - _targetX);
+                int limitx = std::min(_w, startx + _orderX) - startx;
+                for (int c = 0; c < CHANNELS; ++c) {
+                    double const *src = line.data() + c * _w + startx;
+                    double sum = 0.0;
+                    for (int j = 0; j < limitx; ++j) {
+                        sum += row[j] * src[j];
+                    }
+                    out[c * _w + x] = sum;
+                }
+            }
+        }
+    }
+
+    KernelTerms _terms;
+    int _targetX, _targetY, _orderX, _orderY;
+    double _bias;
+};
+
+/// The kernel as applied: divided by the divisor and rotated 180 degrees.
+static std::vector<double> applied_kernel(std::vector<double> const &kernel, double divisor)
+{
+    std::vector<double> result(kernel.rbegin(), kernel.rend());
+    for (auto &k : result) {
+        k /= divisor;
+    }
+    return result;
+}
+
 void FilterConvolveMatrix::render_cairo(FilterSlot &slot) const
 {
     static bool bias_warning = false;
@@ -152,7 +338,15 @@ void FilterConvolveMatrix::render_cairo(FilterSlot &slot) const
         kernel[i] /= divisor; // The code that creates this object makes sure that divisor != 0
     }*/
 
-    if (preserveAlpha) {
+    if (auto terms = decompose_kernel(applied_kernel(kernelMatrix, divisor), orderX, orderY)) {
+        if (preserveAlpha) {
+            SeparableConvolveMatrix<PRESERVE_ALPHA>(input, targetX, targetY, orderX, orderY, bias,
+                                                    std::move(*terms)).render(out);
+        } else {
+            SeparableConvolveMatrix<NO_PRESERVE_ALPHA>(input, targetX, targetY, orderX, orderY, bias,
+                                                       std::move(*terms)).render(out);
+        }
+    } else if (preserveAlpha) {
         //convolve2D<true>(out_data, in_data, width, height, &kernel.front(), orderX, orderY,
         //    targetX, targetY, bias);
         ink_cairo_surface_synthesize(out, ConvolveMatrix<PRESERVE_ALPHA>(input,
@@ -226,6 +420,11 @@ void FilterConvolveMatrix::area_enlarge(Geom::IntRect &area, Geom::Affine const
 
 double FilterConvolveMatrix::complexity(Geom::Affine const &) const
 {
+    if (orderX > 0 && orderY > 0 && kernelMatrix.size() == (unsigned int)(orderX * orderY)) {
+        if (auto terms = decompose_kernel(kernelMatrix, orderX, orderY)) {
+            return std::max<double>(1.0, terms->rows.size() * (orderX + orderY));
+        }
+    }
     return kernelMatrix.size();
 }
 
@@ -22,6 +22,7 @@
 #include "display/cairo-utils.h"
 #include "display/nr-3dutils.h"
 #include "display/nr-filter-diffuselighting.h"
+#include "display/nr-filter-normal-map.h"
 #include "display/nr-filter-slot.h"
 #include "display/nr-filter-units.h"
 #include "display/nr-filter-utils.h"
@@ -43,13 +44,14 @@ struct DiffuseLight : public SurfaceSynth
 {
     DiffuseLight(cairo_surface_t *bumpmap, double scale, double kd)
         : SurfaceSynth(bumpmap)
+        , _normals(NormalMap::get(bumpmap, scale))
         , _scale(scale)
         , _kd(kd) {}
 
 protected:
     guint32 diffuseLighting(int x, int y, NR::Fvector const &light, NR::Fvector const &light_components)
     {
-        NR::Fvector normal = surfaceNormalAt(x, y, _scale);
+        NR::Fvector normal = _normals->normalAt(x, y);
         double k = _kd * NR::scalar_product(normal, light);
 
         guint32 r = CLAMP_D_TO_U8(k * light_components[LIGHT_RED]);
@@ -60,6 +62,7 @@ protected:
         return pxout;
     }
 
+    std::shared_ptr<NormalMap const> _normals;
     double _scale, _kd;
 };
 
@@ -22,10 +22,9 @@
 #include <cstdlib>
 #include <glib.h>
 #include <limits>
-#if HAVE_OPENMP
-#include <omp.h>
-#endif //HAVE_OPENMP
+#include <vector>
 
+#include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-primitive.h"
 #include "display/nr-filter-gaussian.h"
@@ -61,8 +60,18 @@ inline void copy_n(InIt beg_in, Size N, OutIt beg_out) {
     std::copy(beg_in, beg_in+N, beg_out);
 }
 
-// Type used for IIR filter coefficients (can be 10.21 signed fixed point, see Anisotropic Gaussian Filtering Using Fixed Point Arithmetic, Christoph H. Lampert & Oliver Wirjadi, 2006)
-typedef double IIRValue;
+// The IIR filters are templated on the type used for their coefficients and values (which could be
+// 10.21 signed fixed point, see Anisotropic Gaussian Filtering Using Fixed Point Arithmetic,
+// Christoph H. Lampert & Oliver Wirjadi, 2006). Single precision is faster, as twice as many
+// values fit in a vector register, but for large deviations the poles get so close to 1 that
+// rounding errors add up. Up to this deviation, the output stays within one unit of the output
+// computed in double precision.
+static double const IIR_FLOAT_MAX_DEVIATION = 32;
+
+// Number of pixels the vertical IIR pass filters together. The pixels of a row are adjacent in
+// memory, so going down a block of columns reads whole cache lines instead of a single pixel
+// from each, and the loops over a block vectorise.
+static int const IIR_BLOCK = 16;
 
 // Type used for FIR filter coefficients (can be 16.16 unsigned fixed point, should have 8 or more bits in the fractional part, the integer part should be capable of storing approximately 20*255)
 typedef Inkscape::Util::FixedPoint<unsigned int,16> FIRValue;
@@ -265,9 +274,9 @@ static void calcTriggsSdikaM(double const b[N], double M[N*N]) {
     for(unsigned int i=0; i<9; i++) M[i] *= Mscale;
 }
 
-template<unsigned int SIZE>
-static void calcTriggsSdikaInitialization(double const M[N*N], IIRValue const uold[N][SIZE], IIRValue const uplus[SIZE], IIRValue const vplus[SIZE], IIRValue const alpha, IIRValue vold[N][SIZE]) {
-    for(unsigned int c=0; c<SIZE; c++) {
+template<unsigned int SIZE, typename IIRValue>
+static void calcTriggsSdikaInitialization(double const M[N*N], IIRValue const uold[N][SIZE], IIRValue const uplus[SIZE], IIRValue const vplus[SIZE], IIRValue const alpha, IIRValue vold[N][SIZE], unsigned int const size = SIZE) {
+    for(unsigned int c=0; c<size; c++) {
         double uminp[N];
         for(unsigned int i=0; i<N; i++) uminp[i] = uold[i][c] - uplus[c];
         for(unsigned int i=0; i<N; i++) {
@@ -285,7 +294,7 @@ static void calcTriggsSdikaInitialization(double const M[N*N], IIRValue const uo
 }
 
 // Filters over 1st dimension
-template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA>
+template<typename IIRValue, typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA>
 static void
 filter2D_IIR(PT *const dest, int const dstr1, int const dstr2,
              PT const *const src, int const sstr1, int const sstr2,
@@ -302,16 +311,7 @@ filter2D_IIR(PT *const dest, int const dstr1, int const dstr2,
     #define PREMUL_ALPHA_LOOP for(unsigned int c=1; c<PC; ++c)
 #endif
 
-INK_UNUSED(num_threads); // to suppress unused argument compiler warning
-#if HAVE_OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif // HAVE_OPENMP
-    for ( int c2 = 0 ; c2 < n2 ; c2++ ) {
-#if HAVE_OPENMP
-        unsigned int tid = omp_get_thread_num();
-#else
-        unsigned int tid = 0;
-#endif // HAVE_OPENMP
+    ink_parallel_for_threads(n2, num_threads, [&] (int c2, int tid) {
         // corresponding line in the source and output buffer
         PT const * srcimg = src  + c2*sstr2;
         PT       * dstimg = dest + c2*dstr2 + n1*dstr1;
@@ -357,7 +357,78 @@ INK_UNUSED(num_threads); // to suppress unused argument compiler warning
                 for(unsigned int c=0; c<PC; c++) dstimg[c] = clip_round_cast<PT>(v[0][c]);
             }
         }
-    }
+    });
+}
+
+// Filters over 2nd dimension, IIR_BLOCK pixels of each row at a time
+template<typename IIRValue, typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA>
+static void
+filter2D_IIR_columns(PT *const dest, PT const *const src, int const stride,
+                     int const n1, int const n2, IIRValue const b[N+1], double const M[N*N],
+                     IIRValue *const tmpdata[], int const num_threads)
+{
+    assert(src && dest);
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    static unsigned int const alpha_PC = PC-1;
+#else
+    static unsigned int const alpha_PC = 0;
+#endif
+
+    // Writes out one row of a block.
+    auto const store = [] (PT *dstrow, IIRValue const *values, int const size) {
+        for ( int i = 0 ; i < size ; i += PC ) {
+            if ( PREMULTIPLIED_ALPHA ) {
+                dstrow[i+alpha_PC] = clip_round_cast<PT>(values[i+alpha_PC]);
+                for(unsigned int c=0; c<PC; ++c) {
+                    if (c != alpha_PC) dstrow[i+c] = clip_round_cast_varmax<PT>(values[i+c], dstrow[i+alpha_PC]);
+                }
+            } else {
+                for(unsigned int c=0; c<PC; c++) dstrow[i+c] = clip_round_cast<PT>(values[i+c]);
+            }
+        }
+    };
+
+    int const num_blocks = (n2 + IIR_BLOCK - 1) / IIR_BLOCK;
+
+    ink_parallel_for_threads(num_blocks, num_threads, [&] (int block, int tid) {
+        // values per row in this block, and the block's first column in the source and output buffer
+        int const size = std::min(IIR_BLOCK, n2 - block*IIR_BLOCK) * PC;
+        PT const *srccol = src  + block*IIR_BLOCK*PC;
+        PT       *dstcol = dest + block*IIR_BLOCK*PC;
+        IIRValue *const tmp = tmpdata[tid];
+
+        // Border constants
+        IIRValue iplus[IIR_BLOCK*PC]; copy_n(srccol + (n1-1)*stride, size, iplus);
+        // Forward pass
+        IIRValue u[N+1][IIR_BLOCK*PC];
+        for(unsigned int i=0; i<N; i++) copy_n(srccol, size, u[i]);
+        for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
+            PT const *srcrow = srccol + c1*stride;
+            IIRValue *tmprow = tmp + c1*size;
+            for ( int i = 0 ; i < size ; i++ ) {
+                IIRValue const value = srcrow[i]*b[0] + u[0][i]*b[1] + u[1][i]*b[2] + u[2][i]*b[3];
+                u[2][i] = u[1][i];
+                u[1][i] = u[0][i];
+                u[0][i] = value;
+                tmprow[i] = value;
+            }
+        }
+        // Backward pass
+        IIRValue v[N+1][IIR_BLOCK*PC];
+        calcTriggsSdikaInitialization<IIR_BLOCK*PC>(M, u, iplus, iplus, b[0], v, size);
+        store(dstcol + (n1-1)*stride, v[0], size);
+        for ( int c1 = n1-2 ; c1 >= 0 ; c1-- ) {
+            IIRValue const *tmprow = tmp + c1*size;
+            for ( int i = 0 ; i < size ; i++ ) {
+                IIRValue const value = tmprow[i]*b[0] + v[0][i]*b[1] + v[1][i]*b[2] + v[2][i]*b[3];
+                v[2][i] = v[1][i];
+                v[1][i] = v[0][i];
+                v[0][i] = value;
+            }
+            store(dstcol + c1*stride, v[0], size);
+        }
+    });
 }
 
 // Filters over 1st dimension
@@ -371,14 +442,9 @@ filter2D_FIR(PT *const dst, int const dstr1, int const dstr2,
 {
     assert(src && dst);
 
-    // Past pixels seen (to enable in-place operation)
-    PT history[scr_len+1][PC];
-
-INK_UNUSED(num_threads); // suppresses unused argument compiler warning
-#if HAVE_OPENMP
-#pragma omp parallel for num_threads(num_threads) private(history)
-#endif // HAVE_OPENMP
-    for ( int c2 = 0 ; c2 < n2 ; c2++ ) {
+    ink_parallel_for_threads(n2, num_threads, [&] (int c2, int) {
+        // Past pixels seen (to enable in-place operation)
+        PT history[scr_len+1][PC];
 
         // corresponding line in the source buffer
         int const src_line = c2 * sstr2;
@@ -465,12 +531,13 @@ INK_UNUSED(num_threads); // suppresses unused argument compiler warning
                 }
             }
         }
-    }
+    });
 }
 
+template<typename IIRValue>
 static void
 gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_surface_t *dest,
-    IIRValue **tmpdata, int num_threads)
+    int num_threads)
 {
     // Filter variables
     IIRValue b[N+1];  // scaling coefficient + filter coefficients (can be 10.21 fixed point)
@@ -480,11 +547,14 @@ gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_su
     // Compute filter
     calcFilter(deviation, bf);
     for(double & i : bf) i = -i;
-    b[0] = 1; // b[0] == alpha (scaling coefficient)
+    // b[0] == alpha (scaling coefficient), computed from the rounded coefficients so that the
+    // filter's gain stays exactly 1
+    double alpha = 1;
     for(size_t i=0; i<N; i++) {
         b[i+1] = bf[i];
-        b[0] -= b[i+1];
+        alpha -= b[i+1];
     }
+    b[0] = alpha;
 
     // Compute initialization matrix
     calcTriggsSdikaM(bf, M);
@@ -494,25 +564,64 @@ gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_su
     int h = cairo_image_surface_get_height(src);
     if (d != Geom::X) std::swap(w, h);
 
+    // Temporary storage for each thread: a row for the horizontal pass, a block of columns for the vertical one
+    // NOTE: This can be eliminated, but it reduces the precision a bit
+    int const bytes_per_pixel = cairo_image_surface_get_format(src) == CAIRO_FORMAT_A8 ? 1 : 4;
+    std::size_t const tmpsize = std::size_t(w) * (d == Geom::X ? 1 : IIR_BLOCK) * bytes_per_pixel;
+    std::vector<IIRValue> tmpbuffer(tmpsize * num_threads);
+    std::vector<IIRValue *> tmpdata(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+        tmpdata[i] = tmpbuffer.data() + i * tmpsize;
+    }
+
     // Filter
+    if (d != Geom::X) {
+        switch (cairo_image_surface_get_format(src)) {
+        case CAIRO_FORMAT_A8:        ///< Grayscale
+            filter2D_IIR_columns<IIRValue,unsigned char,1,false>(
+                cairo_image_surface_get_data(dest), cairo_image_surface_get_data(src), stride,
+                w, h, b, M, tmpdata.data(), num_threads);
+            break;
+        case CAIRO_FORMAT_ARGB32: ///< Premultiplied 8 bit RGBA
+            filter2D_IIR_columns<IIRValue,unsigned char,4,true>(
+                cairo_image_surface_get_data(dest), cairo_image_surface_get_data(src), stride,
+                w, h, b, M, tmpdata.data(), num_threads);
+            break;
+        default:
+            g_warning("gaussian_pass_IIR: unsupported image format");
+        };
+        return;
+    }
+
     switch (cairo_image_surface_get_format(src)) {
     case CAIRO_FORMAT_A8:        ///< Grayscale
-        filter2D_IIR<unsigned char,1,false>(
-            cairo_image_surface_get_data(dest), d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
-            cairo_image_surface_get_data(src),  d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
-            w, h, b, M, tmpdata, num_threads);
+        filter2D_IIR<IIRValue,unsigned char,1,false>(
+            cairo_image_surface_get_data(dest), 1, stride,
+            cairo_image_surface_get_data(src),  1, stride,
+            w, h, b, M, tmpdata.data(), num_threads);
         break;
     case CAIRO_FORMAT_ARGB32: ///< Premultiplied 8 bit RGBA
-        filter2D_IIR<unsigned char,4,true>(
-            cairo_image_surface_get_data(dest), d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
-            cairo_image_surface_get_data(src),  d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
-            w, h, b, M, tmpdata, num_threads);
+        filter2D_IIR<IIRValue,unsigned char,4,true>(
+            cairo_image_surface_get_data(dest), 4, stride,
+            cairo_image_surface_get_data(src),  4, stride,
+            w, h, b, M, tmpdata.data(), num_threads);
         break;
     default:
         g_warning("gaussian_pass_IIR: unsupported image format");
     };
 }
 
+static void
+gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_surface_t *dest,
+    int num_threads)
+{
+    if (deviation <= IIR_FLOAT_MAX_DEVIATION) {
+        gaussian_pass_IIR<float>(d, deviation, src, dest, num_threads);
+    } else {
+        gaussian_pass_IIR<double>(d, deviation, src, dest, num_threads);
+    }
+}
+
 static void
 gaussian_pass_FIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_surface_t *dest,
     int num_threads)
@@ -587,16 +696,6 @@ void FilterGaussian::render_cairo(FilterSlot &slot) const
     deviation_x_orig *= device_scale;
     deviation_y_orig *= device_scale;
 
-    cairo_format_t fmt = cairo_image_surface_get_format(in);
-    int bytes_per_pixel = 0;
-    switch (fmt) {
-        case CAIRO_FORMAT_A8:
-            bytes_per_pixel = 1; break;
-        case CAIRO_FORMAT_ARGB32:
-        default:
-            bytes_per_pixel = 4; break;
-    }
-
     int quality = slot.get_blurquality();
     int threads = get_num_filter_threads();
     int x_step = 1 << _effect_subsample_step_log2(deviation_x_orig, quality);
@@ -619,16 +718,6 @@ void FilterGaussian::render_cairo(FilterSlot &slot) const
     bool use_IIR_x = deviation_x > 3;
     bool use_IIR_y = deviation_y > 3;
 
-    // Temporary storage for IIR filter
-    // NOTE: This can be eliminated, but it reduces the precision a bit
-    IIRValue * tmpdata[threads];
-    std::fill_n(tmpdata, threads, (IIRValue*)0);
-    if ( use_IIR_x || use_IIR_y ) {
-        for(int i = 0; i < threads; ++i) {
-            tmpdata[i] = new IIRValue[std::max(w_downsampled,h_downsampled)*bytes_per_pixel];
-        }
-    }
-
     cairo_surface_t *downsampled = nullptr;
     if (resampling) {
         // Divide by device scale as w_downsampled is in pixels while
@@ -647,7 +736,7 @@ void FilterGaussian::render_cairo(FilterSlot &slot) const
 
     if (scr_len_x > 0) {
         if (use_IIR_x) {
-            gaussian_pass_IIR(Geom::X, deviation_x, downsampled, downsampled, tmpdata, threads);
+            gaussian_pass_IIR(Geom::X, deviation_x, downsampled, downsampled, threads);
         } else {
             gaussian_pass_FIR(Geom::X, deviation_x, downsampled, downsampled, threads);
         }
@@ -655,19 +744,12 @@ void FilterGaussian::render_cairo(FilterSlot &slot) const
 
     if (scr_len_y > 0) {
         if (use_IIR_y) {
-            gaussian_pass_IIR(Geom::Y, deviation_y, downsampled, downsampled, tmpdata, threads);
+            gaussian_pass_IIR(Geom::Y, deviation_y, downsampled, downsampled, threads);
         } else {
             gaussian_pass_FIR(Geom::Y, deviation_y, downsampled, downsampled, threads);
         }
     }
 
-    // free the temporary data
-    if ( use_IIR_x || use_IIR_y ) {
-        for(int i = 0; i < threads; ++i) {
-            delete[] tmpdata[i];
-        }
-    }
-
     cairo_surface_mark_dirty(downsampled);
     if (resampling) {
         cairo_surface_t *upsampled = cairo_surface_create_similar(downsampled, cairo_surface_get_content(downsampled),
@@ -16,8 +16,8 @@
 
 #include <cmath>
 #include <algorithm>
-#include <deque>
 #include <functional>
+#include <vector>
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-morphology.h"
@@ -39,22 +39,82 @@ enum MorphologyOp
 
 namespace {
 
-/* This performs one "half" of the morphology operation by calculating 
+// Width in bytes of the strips of columns filtered together by the vertical pass.
+constexpr int STRIP = 256;
+
+/* Computes the componentwise extreme over a sliding window of 2*ri+1 elements, using the
+ * algorithm due to: Marcel van Herk (1992), "A fast algorithm for local minimum and maximum
+ * filters on rectangular and octagonal kernels", and Joseph Gil, Michael Werman (1993).
+ * The elements are split into blocks as wide as the window, so every window consists of the end
+ * of one block and the start of the next. With the extremes of all block prefixes and suffixes
+ * at hand, each output takes a single comparison, so the cost does not depend on the radius.
+ *
+ * Each element consists of len bytes, and is step bytes away from the next one. This lets the
+ * same code filter a row of pixels, or a strip of rows one whole run of bytes at a time.
+ * Elements beyond the end count as transparent black, those before the start are ignored.
+ * prefix and suffix must have room for (n + 2*min(ri, n)) * len bytes.
+ */
+template <typename Comparison>
+void slidingExtreme(unsigned char const *in, int in_step, unsigned char *out, int out_step,
+                    int n, int len, int ri, unsigned char *prefix, unsigned char *suffix)
+{
+    auto const extreme = [] (unsigned char a, unsigned char b) { return Comparison()(a, b) ? a : b; };
+    unsigned char const identity = extreme(0, 255) == 0 ? 255 : 0;
+
+    // Windows wider than this all contain the whole input and the border after it.
+    ri = std::min(ri, n);
+    int const wi = 2 * ri + 1;
+    int const m = n + 2 * ri;
+
+    auto const load = [&] (int q, unsigned char *dest) {
+        if (q < ri) {
+            std::fill(dest, dest + len, identity);
+        } else if (q < ri + n) {
+            std::copy(in + (q - ri) * in_step, in + (q - ri) * in_step + len, dest);
+        } else {
+            std::fill(dest, dest + len, 0);
+        }
+    };
+
+    for (int q = 0; q < m; ++q) {
+        unsigned char *g = prefix + q * len;
+        load(q, g);
+        if (q % wi != 0) {
+            for (int c = 0; c < len; ++c) {
+                g[c] = extreme(g[c], g[c - len]);
+            }
+        }
+    }
+    for (int q = m - 1; q >= 0; --q) {
+        unsigned char *h = suffix + q * len;
+        load(q, h);
+        if (q % wi != wi - 1 && q != m - 1) {
+            for (int c = 0; c < len; ++c) {
+                h[c] = extreme(h[c], h[c + len]);
+            }
+        }
+    }
+
+    for (int o = 0; o < n; ++o) {
+        unsigned char const *h = suffix + o * len;
+        unsigned char const *g = prefix + (o + 2 * ri) * len;
+        unsigned char *out_p = out + o * out_step;
+        for (int c = 0; c < len; ++c) {
+            out_p[c] = extreme(h[c], g[c]);
+        }
+    }
+}
+
+/* This performs one "half" of the morphology operation by calculating
  * the componentwise extreme in the specified axis with the given radius.
  * Extreme of row extremes is equal to the extreme of components, so this
  * doesn't change the result.
- * The algorithm is due to: Petr Dokládal, Eva Dokládalová (2011), "Computationally efficient, one-pass algorithm for morphological filters"
- * TODO: Currently only the 1D algorithm is implemented, but it should not be too difficult (and at the very least more memory efficient) to implement the full 2D algorithm.
- *       One problem with the 2D algorithm is that it is harder to parallelize.
  */
 template <typename Comparison, Geom::Dim2 axis, int BPP>
 void morphologicalFilter1D(cairo_surface_t * const input, cairo_surface_t * const out, double radius)
 {
-    Comparison comp;
-
     int w = cairo_image_surface_get_width(out);
     int h = cairo_image_surface_get_height(out);
-    if (axis == Geom::Y) std::swap(w,h);
 
     int stridein = cairo_image_surface_get_stride(input);
     int strideout = cairo_image_surface_get_stride(out);
@@ -63,92 +123,38 @@ void morphologicalFilter1D(cairo_surface_t * const input, cairo_surface_t * cons
     unsigned char *out_data = cairo_image_surface_get_data(out);
 
     int ri = round(radius); // TODO: Support fractional radii?
-    int wi = 2*ri+1;
 
-    #if HAVE_OPENMP
+    // Horizontally, each row is filtered on its own. Vertically, strips of columns are filtered
+    // together, which keeps memory accesses sequential and compares many bytes at once.
+    int n = axis == Geom::X ? w : h;
+    int lines = axis == Geom::X ? h : (w * BPP + STRIP - 1) / STRIP;
+    int len = axis == Geom::X ? BPP : STRIP;
+    std::size_t buffer_size = (std::size_t)(n + 2 * std::min(ri, n)) * len;
+
     int limit = w * h;
-    #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(get_num_filter_threads())
-    #endif // HAVE_OPENMP
-    for (int i = 0; i < h; ++i) {
-        // TODO: Store position and value in one 32 bit integer? 24 bits should be enough for a position, it would be quite strange to have an image with a width/height of more than 16 million(!).
-        std::deque<std::pair<int, unsigned char>> vals[BPP]; // In my tests it was actually slightly faster to allocate it here than allocate it once for all threads and retrieving the correct set based on the thread id.
-
-        // Initialize with transparent black
-        for (int p = 0; p < BPP; ++p) {
-            vals[p].emplace_back(-1, 0); // TODO: Only do this when performing an erosion?
+    int num_threads = limit > PARALLEL_THRESHOLD ? get_num_filter_threads() : 1;
+
+    // Scratch buffers for each thread, allocated by the thread when it first needs them.
+    std::vector<std::vector<unsigned char>> prefixes(num_threads);
+    std::vector<std::vector<unsigned char>> suffixes(num_threads);
+
+    ink_parallel_for_threads(lines, num_threads, [&] (int i, int thread) {
+        auto &prefix = prefixes[thread];
+        auto &suffix = suffixes[thread];
+        if (prefix.empty()) {
+            prefix.resize(buffer_size);
+            suffix.resize(buffer_size);
         }
 
-        // Process "row"
-        unsigned char *in_p = in_data + i * (axis == Geom::X ? stridein : BPP);
-        unsigned char *out_p = out_data + i * (axis == Geom::X ? strideout : BPP);
-        /* This is the "short but slow" version, which might be easier to follow, the longer but faster version follows.
-        for (int j = 0; j < w+ri; ++j) {
-            for(int p = 0; p < BPP; ++p) { // Iterate over channels
-                // Push new value onto FIFO, erasing any previous values that are "useless" (see paper) or out-of-range
-                if (!vals[p].empty() && vals[p].front().first+wi <= j) vals[p].pop_front(); // out-of-range
-                if (j < w) {
-                    while(!vals[p].empty() && !comp(vals[p].back().second, *in_p)) vals[p].pop_back(); // useless
-                    vals[p].emplace_back(j, *in_p);
-                    ++in_p;
-                } else if (j == w) { // Transparent black beyond the image. TODO: Only do this when performing an erosion?
-                    while(!vals[p].empty() && !comp(vals[p].back().second, 0)) vals[p].pop_back();
-                    vals[p].emplace_back(j, 0);
-                }
-                // Set output
-                if (j >= ri) {
-                    *out_p = vals[p].front().second;
-                    ++out_p;
-                }
-            }
-            if (axis == Geom::Y && j < w  ) in_p += stridein - BPP;
-            if (axis == Geom::Y && j >= ri) out_p += strideout - BPP;
-        }*/
-        for (int j = 0; j < std::min(ri,w); ++j) {
-            for(int p = 0; p < BPP; ++p) { // Iterate over channels
-                // Push new value onto FIFO, erasing any previous values that are "useless" (see paper) or out-of-range
-                if (!vals[p].empty() && vals[p].front().first <= j) vals[p].pop_front(); // out-of-range
-                while(!vals[p].empty() && !comp(vals[p].back().second, *in_p)) vals[p].pop_back(); // useless
-                vals[p].emplace_back(j + wi, *in_p);
-                ++in_p;
-            }
-            if (axis == Geom::Y) in_p += stridein - BPP;
-        }
-        // We have now done all preparatory work.
-        // If w<=ri, then the following loop does nothing (which is as it should).
-        for (int j = ri; j < w; ++j) {
-            for(int p = 0; p < BPP; ++p) { // Iterate over channels
-                // Push new value onto FIFO, erasing any previous values that are "useless" (see paper) or out-of-range
-                if (!vals[p].empty() && vals[p].front().first <= j) vals[p].pop_front(); // out-of-range
-                while(!vals[p].empty() && !comp(vals[p].back().second, *in_p)) vals[p].pop_back(); // useless
-                vals[p].emplace_back(j + wi, *in_p);
-                ++in_p;
-                // Set output
-                *out_p = vals[p].front().second;
-                ++out_p;
-            }
-            if (axis == Geom::Y) {
-                in_p += stridein - BPP;
-                out_p += strideout - BPP;
-            }
-        }
-        // We have now done all work which involves both input and output.
-        // The following loop makes sure that the border is handled correctly.
-        for(int p = 0; p < BPP; ++p) { // Iterate over channels
-            while(!vals[p].empty() && !comp(vals[p].back().second, 0)) vals[p].pop_back();
-            vals[p].emplace_back(w + wi, 0);
-        }
-        // Now we just have to finish the output.
-        for (int j = std::max(w,ri); j < w+ri; ++j) {
-            for(int p = 0; p < BPP; ++p) { // Iterate over channels
-                // Remove out-of-range values
-                if (!vals[p].empty() && vals[p].front().first <= j) vals[p].pop_front(); // out-of-range
-                // Set output
-                *out_p = vals[p].front().second;
-                ++out_p;
-            }
-            if (axis == Geom::Y) out_p += strideout - BPP;
+        if (axis == Geom::X) {
+            slidingExtreme<Comparison>(in_data + i * stridein, BPP, out_data + i * strideout, BPP,
+                                       n, BPP, ri, prefix.data(), suffix.data());
+        } else {
+            int offset = i * STRIP;
+            slidingExtreme<Comparison>(in_data + offset, stridein, out_data + offset, strideout,
+                                       n, std::min(STRIP, w * BPP - offset), ri, prefix.data(), suffix.data());
         }
-    }
+    });
 
     cairo_surface_mark_dirty(out);
 }
@@ -223,11 +229,10 @@ void FilterMorphology::area_enlarge(Geom::IntRect &area, Geom::Affine const &tra
     area.expandBy(enlarge_x, enlarge_y);
 }
 
-double FilterMorphology::complexity(Geom::Affine const &trans) const
+double FilterMorphology::complexity(Geom::Affine const &) const
 {
-    int enlarge_x = std::ceil(xradius * trans.expansionX());
-    int enlarge_y = std::ceil(yradius * trans.expansionY());
-    return enlarge_x * enlarge_y;
+    // Two passes, each taking three comparisons per pixel whatever the radius.
+    return 6.0;
 }
 
 void FilterMorphology::set_operator(FilterMorphologyOperator o)
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Surface normals shared by the lighting filter primitives
+ *
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+
+#include "display/cairo-templates.h"
+#include "display/cairo-utils.h"
+#include "display/nr-filter-normal-map.h"
+
+namespace Inkscape {
+namespace Filters {
+
+namespace {
+
+// Keep at most this many bytes, over all cached normal maps.
+constexpr std::size_t CACHE_BUDGET = std::size_t{128} << 20;
+
+struct NormalMapCache
+{
+    std::mutex mutex;
+    std::list<std::shared_ptr<NormalMap const>> maps; ///< Most recently used first.
+    std::size_t size = 0;
+};
+
+NormalMapCache &get_cache()
+{
+    static NormalMapCache cache;
+    return cache;
+}
+
+/**
+ * Call f(row) with the alpha channel of each row of the surface in turn, read straight from its
+ * data, for as long as f returns true. Returns whether every row was visited.
+ */
+template <typename F>
+bool for_each_alpha_row(cairo_surface_t *surface, int width, int height, F &&f)
+{
+    cairo_surface_flush(surface);
+    unsigned char const *data = cairo_image_surface_get_data(surface);
+    int const stride = cairo_image_surface_get_stride(surface);
+
+    if (cairo_surface_get_content(surface) == CAIRO_CONTENT_ALPHA) {
+        for (int y = 0; y < height; ++y) {
+            if (!f(data + y * stride)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<unsigned char> row(width);
+    for (int y = 0; y < height; ++y) {
+        auto px = reinterpret_cast<guint32 const *>(data + y * stride);
+        for (int x = 0; x < width; ++x) {
+            row[x] = px[x] >> 24;
+        }
+        if (!f(row.data())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Hash the alpha channel eight pixels at a time.
+std::uint64_t hash_alpha(cairo_surface_t *surface, int width, int height)
+{
+    constexpr std::uint64_t prime = 0x100000001b3;
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for_each_alpha_row(surface, width, height, [&] (unsigned char const *row) {
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, row + x, sizeof(word));
+            hash = (hash ^ word) * prime;
+            hash ^= hash >> 29;
+        }
+        for (; x < width; ++x) {
+            hash = (hash ^ row[x]) * prime;
+        }
+        return true;
+    });
+    return hash;
+}
+
+std::vector<unsigned char> extract_alpha(cairo_surface_t *surface, int width, int height)
+{
+    std::vector<unsigned char> alpha(width * height);
+    auto dest = alpha.data();
+    for_each_alpha_row(surface, width, height, [&] (unsigned char const *row) {
+        dest = std::copy_n(row, width, dest);
+        return true;
+    });
+    return alpha;
+}
+
+bool alpha_equals(cairo_surface_t *surface, int width, int height, std::vector<unsigned char> const &alpha)
+{
+    auto expected = alpha.data();
+    return for_each_alpha_row(surface, width, height, [&] (unsigned char const *row) {
+        bool const equal = std::equal(row, row + width, expected);
+        expected += width;
+        return equal;
+    });
+}
+
+} // namespace
+
+NormalMap::NormalMap(cairo_surface_t *bumpmap, std::uint64_t hash, int width, int height, double scale)
+    : _hash(hash)
+    , _alpha(extract_alpha(bumpmap, width, height))
+    , _width(width)
+    , _height(height)
+    , _scale(scale)
+    , _normals(3 * width * height)
+{
+    SurfaceSynth synth(bumpmap);
+
+    int limit = width * height;
+    ink_parallel_for(height, limit > PARALLEL_THRESHOLD, [&] (int y) {
+        float *n = _normals.data() + 3 * y * width;
+        for (int x = 0; x < width; ++x) {
+            NR::Fvector normal = synth.surfaceNormalAt(x, y, scale);
+            *n++ = normal[X_3D];
+            *n++ = normal[Y_3D];
+            *n++ = normal[Z_3D];
+        }
+    });
+}
+
+std::shared_ptr<NormalMap const> NormalMap::get(cairo_surface_t *bumpmap, double scale)
+{
+    int width = cairo_image_surface_get_width(bumpmap);
+    int height = cairo_image_surface_get_height(bumpmap);
+    auto const hash = hash_alpha(bumpmap, width, height);
+
+    // The contents are only compared once everything else matches, which they almost always do.
+    auto &cache = get_cache();
+    {
+        auto lock = std::lock_guard(cache.mutex);
+        for (auto it = cache.maps.begin(); it != cache.maps.end(); ++it) {
+            auto const &map = **it;
+            if (map._hash == hash && map._width == width && map._height == height && map._scale == scale
+                && alpha_equals(bumpmap, width, height, map._alpha)) {
+                cache.maps.splice(cache.maps.begin(), cache.maps, it);
+                return cache.maps.front();
+            }
+        }
+    }
+
+    auto map = std::shared_ptr<NormalMap const>(new NormalMap(bumpmap, hash, width, height, scale));
+
+    if (map->_size() <= CACHE_BUDGET) {
+        auto lock = std::lock_guard(cache.mutex);
+        cache.maps.push_front(map);
+        cache.size += map->_size();
+        while (cache.size > CACHE_BUDGET) {
+            cache.size -= cache.maps.back()->_size();
+            cache.maps.pop_back();
+        }
+    }
+
+    return map;
+}
+
+void NormalMap::clear_cache()
+{
+    auto &cache = get_cache();
+    auto lock = std::lock_guard(cache.mutex);
+    cache.maps.clear();
+    cache.size = 0;
+}
+
+} // namespace Filters
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#ifndef SEEN_NR_FILTER_NORMAL_MAP_H
+#define SEEN_NR_FILTER_NORMAL_MAP_H
+
+/*
+ * Surface normals shared by the lighting filter primitives
+ *
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <cairo.h>
+
+#include "display/nr-3dutils.h"
+
+namespace Inkscape {
+namespace Filters {
+
+/**
+ * The surface normals of a bump map, as used by feDiffuseLighting and feSpecularLighting.
+ *
+ * Computing them takes a Sobel filter and a square root per pixel, which is most of the work
+ * of a lighting filter. Filter renderers are rebuilt whenever a light is edited, so the normals
+ * of the most recently used bump maps are kept in a small process-wide cache, keyed by a hash of
+ * their alpha channel, their size and the surface scale, and checked against the full alpha
+ * channel only when those match. Dragging a light around then reuses them instead of computing
+ * them again.
+ */
+class NormalMap
+{
+public:
+    /// Get the normals of the alpha channel of the given surface, computing them if needed.
+    static std::shared_ptr<NormalMap const> get(cairo_surface_t *bumpmap, double scale);
+
+    /// Forget all cached normal maps, for example so that benchmarks measure computing them.
+    static void clear_cache();
+
+    NR::Fvector normalAt(int x, int y) const
+    {
+        float const *n = _normals.data() + 3 * (y * _width + x);
+        return NR::Fvector(n[0], n[1], n[2]);
+    }
+
+private:
+    NormalMap(cairo_surface_t *bumpmap, std::uint64_t hash, int width, int height, double scale);
+
+    std::size_t _size() const { return _alpha.size() + _normals.size() * sizeof(float); }
+
+    std::uint64_t _hash;               ///< Hash of the alpha channel.
+    std::vector<unsigned char> _alpha; ///< The alpha channel the normals were computed from.
+    int _width, _height;
+    double _scale;
+    std::vector<float> _normals;       ///< x, y and z of each pixel, row by row.
+};
+
+} // namespace Filters
+} // namespace Inkscape
+
+#endif // SEEN_NR_FILTER_NORMAL_MAP_H
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
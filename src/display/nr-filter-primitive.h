@@ -40,6 +40,9 @@ public:
     virtual void render_cairo(FilterSlot &slot) const;
     virtual void area_enlarge(Geom::IntRect &area, Geom::Affine const &m) const {}
 
+    /// Release any results kept from earlier renders.
+    virtual void drop_cache() {}
+
     /**
      * Sets the input slot number 'slot' to be used as input in rendering
      * filter primitive 'primitive'
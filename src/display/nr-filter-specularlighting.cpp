@@ -22,6 +22,7 @@
 #include "display/cairo-utils.h"
 #include "display/nr-3dutils.h"
 #include "display/nr-filter-specularlighting.h"
+#include "display/nr-filter-normal-map.h"
 #include "display/nr-filter-slot.h"
 #include "display/nr-filter-units.h"
 #include "display/nr-filter-utils.h"
@@ -45,6 +46,7 @@ struct SpecularLight : public SurfaceSynth
 {
     SpecularLight(cairo_surface_t *bumpmap, double scale, double specular_constant, double specular_exponent)
         : SurfaceSynth(bumpmap)
+        , _normals(NormalMap::get(bumpmap, scale))
         , _scale(scale)
         , _ks(specular_constant)
         , _exp(specular_exponent) {}
@@ -52,7 +54,7 @@ struct SpecularLight : public SurfaceSynth
 protected:
     guint32 specularLighting(int x, int y, NR::Fvector const &halfway, NR::Fvector const &light_components)
     {
-        NR::Fvector normal = surfaceNormalAt(x, y, _scale);
+        NR::Fvector normal = _normals->normalAt(x, y);
         double sp = NR::scalar_product(normal, halfway);
         double k = sp <= 0.0 ? 0.0 : _ks * std::pow(sp, _exp);
 
@@ -69,6 +71,7 @@ protected:
         return pxout;
     }
 
+    std::shared_ptr<NormalMap const> _normals;
     double _scale, _ks, _exp;
 };
 
@@ -24,7 +24,10 @@
 #include "display/nr-filter-turbulence.h"
 #include "display/nr-filter-units.h"
 #include "display/nr-filter-utils.h"
+#include <algorithm>
 #include <cmath>
+#include <list>
+#include <mutex>
 
 namespace Inkscape {
 namespace Filters{
@@ -64,15 +67,16 @@ public:
             for (i = 0; i < BSize; ++i) {
                 _latticeSelector[i] = i;
 
+                double gx, gy;
                 do {
-                    _gradient[i][k][0] = static_cast<double>(_random() % (BSize * 2) - BSize) / BSize;
-                    _gradient[i][k][1] = static_cast<double>(_random() % (BSize * 2) - BSize) / BSize;
-                } while (_gradient[i][k][0] == 0 && _gradient[i][k][1] == 0);
+                    gx = static_cast<double>(_random() % (BSize * 2) - BSize) / BSize;
+                    gy = static_cast<double>(_random() % (BSize * 2) - BSize) / BSize;
+                } while (gx == 0 && gy == 0);
 
                 // normalize gradient
-                double s = hypot(_gradient[i][k][0], _gradient[i][k][1]);
-                _gradient[i][k][0] /= s;
-                _gradient[i][k][1] /= s;
+                double s = hypot(gx, gy);
+                _gradient[i][0][k] = gx / s;
+                _gradient[i][1][k] = gy / s;
             }
         }
         while (--i) {
@@ -87,8 +91,8 @@ public:
             _latticeSelector[BSize + i] = _latticeSelector[i];
 
             for (int k = 0; k < 4; ++k) {
-                _gradient[BSize + i][k][0] = _gradient[i][k][0];
-                _gradient[BSize + i][k][1] = _gradient[i][k][1];
+                _gradient[BSize + i][0][k] = _gradient[i][0][k];
+                _gradient[BSize + i][1][k] = _gradient[i][1][k];
             }
         }
 
@@ -116,109 +120,106 @@ public:
         _inited = true;
     }
 
-    G_GNUC_PURE
-    guint32 turbulencePixel(Geom::Point const &p) const
+    /**
+     * Compute n pixels of a row, the i-th one at start + i * step in primitive units.
+     *
+     * The noise is evaluated in float for all four channels at once, with the gradients of each
+     * lattice point stored next to each other, so that the compiler can turn the channel loops
+     * into vector instructions. Lattice coordinates stay in double, since they grow with every
+     * octave.
+     */
+    void turbulenceRow(Geom::Point const &start, Geom::Point const &step, int n, guint32 *out) const
     {
-        int wrapx = _wrapx, wrapy = _wrapy, wrapw = _wrapw, wraph = _wraph;
-
-        double pixel[4];
-        double x = p[Geom::X] * _baseFreq[Geom::X];
-        double y = p[Geom::Y] * _baseFreq[Geom::Y];
-        double ratio = 1.0;
-
-        for (double & k : pixel)
-            k = 0.0;
-
-        for (int octave = 0; octave < _octaves; ++octave)
-        {
-            double tx = x + PerlinOffset;
-            double bx = floor(tx);
-            double rx0 = tx - bx, rx1 = rx0 - 1.0;
-            int bx0 = bx, bx1 = bx0 + 1;
-
-            double ty = y + PerlinOffset;
-            double by = floor(ty);
-            double ry0 = ty - by, ry1 = ry0 - 1.0;
-            int by0 = by, by1 = by0 + 1;
-
-            if (_stitchTiles) {
-                if (bx0 >= wrapx) bx0 -= wrapw;
-                if (bx1 >= wrapx) bx1 -= wrapw;
-                if (by0 >= wrapy) by0 -= wraph;
-                if (by1 >= wrapy) by1 -= wraph;
-            }
-            bx0 &= BMask;
-            bx1 &= BMask;
-            by0 &= BMask;
-            by1 &= BMask;
-
-            int i = _latticeSelector[bx0];
-            int j = _latticeSelector[bx1];
-            int b00 = _latticeSelector[i + by0];
-            int b01 = _latticeSelector[i + by1];
-            int b10 = _latticeSelector[j + by0];
-            int b11 = _latticeSelector[j + by1];
-
-            double sx = _scurve(rx0);
-            double sy = _scurve(ry0);
-
-            double result[4];
-            // channel numbering: R=0, G=1, B=2, A=3
-            for (int k = 0; k < 4; ++k) {
-                double const *qxa = _gradient[b00][k];
-                double const *qxb = _gradient[b10][k];
-                double a = _lerp(sx, rx0 * qxa[0] + ry0 * qxa[1],
-                                     rx1 * qxb[0] + ry0 * qxb[1]);
-                double const *qya = _gradient[b01][k];
-                double const *qyb = _gradient[b11][k];
-                double b = _lerp(sx, rx0 * qya[0] + ry1 * qya[1],
-                                     rx1 * qyb[0] + ry1 * qyb[1]);
-                result[k] = _lerp(sy, a, b);
+        for (int px = 0; px < n; ++px) {
+            int wrapx = _wrapx, wrapy = _wrapy, wrapw = _wrapw, wraph = _wraph;
+
+            double x = (start[Geom::X] + px * step[Geom::X]) * _baseFreq[Geom::X];
+            double y = (start[Geom::Y] + px * step[Geom::Y]) * _baseFreq[Geom::Y];
+            float ratio = 1.0f;
+
+            float pixel[4] = {};
+
+            for (int octave = 0; octave < _octaves; ++octave) {
+                double tx = x + PerlinOffset;
+                double bx = std::floor(tx);
+                float rx0 = tx - bx, rx1 = rx0 - 1.0f;
+                int bx0 = bx, bx1 = bx0 + 1;
+
+                double ty = y + PerlinOffset;
+                double by = std::floor(ty);
+                float ry0 = ty - by, ry1 = ry0 - 1.0f;
+                int by0 = by, by1 = by0 + 1;
+
+                if (_stitchTiles) {
+                    if (bx0 >= wrapx) bx0 -= wrapw;
+                    if (bx1 >= wrapx) bx1 -= wrapw;
+                    if (by0 >= wrapy) by0 -= wraph;
+                    if (by1 >= wrapy) by1 -= wraph;
+                }
+                bx0 &= BMask;
+                bx1 &= BMask;
+                by0 &= BMask;
+                by1 &= BMask;
+
+                int i = _latticeSelector[bx0];
+                int j = _latticeSelector[bx1];
+                auto const &q00 = _gradient[_latticeSelector[i + by0]];
+                auto const &q01 = _gradient[_latticeSelector[i + by1]];
+                auto const &q10 = _gradient[_latticeSelector[j + by0]];
+                auto const &q11 = _gradient[_latticeSelector[j + by1]];
+
+                float sx = _scurve(rx0);
+                float sy = _scurve(ry0);
+                float inv_ratio = 1.0f / ratio;
+
+                float result[4];
+                // channel numbering: R=0, G=1, B=2, A=3
+                for (int k = 0; k < 4; ++k) {
+                    float a = _lerp(sx, rx0 * q00[0][k] + ry0 * q00[1][k],
+                                        rx1 * q10[0][k] + ry0 * q10[1][k]);
+                    float b = _lerp(sx, rx0 * q01[0][k] + ry1 * q01[1][k],
+                                        rx1 * q11[0][k] + ry1 * q11[1][k]);
+                    result[k] = _lerp(sy, a, b);
+                }
+
+                if (_fractalnoise) {
+                    for (int k = 0; k < 4; ++k)
+                        pixel[k] += result[k] * inv_ratio;
+                } else {
+                    for (int k = 0; k < 4; ++k)
+                        pixel[k] += std::fabs(result[k]) * inv_ratio;
+                }
+
+                x *= 2;
+                y *= 2;
+                ratio *= 2;
+
+                if (_stitchTiles) {
+                    // Update stitch values. Subtracting PerlinOffset before the multiplication and
+                    // adding it afterward simplifies to subtracting it once.
+                    wrapw *= 2;
+                    wraph *= 2;
+                    wrapx = wrapx*2 - PerlinOffset;
+                    wrapy = wrapy*2 - PerlinOffset;
+                }
             }
 
             if (_fractalnoise) {
-                for (int k = 0; k < 4; ++k)
-                    pixel[k] += result[k] / ratio;
+                for (float &k : pixel)
+                    k = (k * 255.0f + 255.0f) / 2;
             } else {
-                for (int k = 0; k < 4; ++k)
-                    pixel[k] += fabs(result[k]) / ratio;
+                for (float &k : pixel)
+                    k *= 255.0f;
             }
-
-            x *= 2;
-            y *= 2;
-            ratio *= 2;
-
-            if(_stitchTiles)
-            {
-                // Update stitch values. Subtracting PerlinOffset before the multiplication and
-                // adding it afterward simplifies to subtracting it once.
-                wrapw *= 2;
-                wraph *= 2;
-                wrapx = wrapx*2 - PerlinOffset;
-                wrapy = wrapy*2 - PerlinOffset;
-            }
-        }
-
-        if (_fractalnoise) {
-            guint32 r = CLAMP_D_TO_U8((pixel[0]*255.0 + 255.0) / 2);
-            guint32 g = CLAMP_D_TO_U8((pixel[1]*255.0 + 255.0) / 2);
-            guint32 b = CLAMP_D_TO_U8((pixel[2]*255.0 + 255.0) / 2);
-            guint32 a = CLAMP_D_TO_U8((pixel[3]*255.0 + 255.0) / 2);
-            r = premul_alpha(r, a);
-            g = premul_alpha(g, a);
-            b = premul_alpha(b, a);
-            ASSEMBLE_ARGB32(pxout, a,r,g,b);
-            return pxout;
-        } else {
-            guint32 r = CLAMP_D_TO_U8(pixel[0]*255.0);
-            guint32 g = CLAMP_D_TO_U8(pixel[1]*255.0);
-            guint32 b = CLAMP_D_TO_U8(pixel[2]*255.0);
-            guint32 a = CLAMP_D_TO_U8(pixel[3]*255.0);
+            guint32 r = CLAMP_D_TO_U8(pixel[0]);
+            guint32 g = CLAMP_D_TO_U8(pixel[1]);
+            guint32 b = CLAMP_D_TO_U8(pixel[2]);
+            guint32 a = CLAMP_D_TO_U8(pixel[3]);
             r = premul_alpha(r, a);
             g = premul_alpha(g, a);
             b = premul_alpha(b, a);
             ASSEMBLE_ARGB32(pxout, a,r,g,b);
-            return pxout;
+            out[px] = pxout;
         }
     }
 
@@ -271,12 +272,12 @@ private:
         return _seed;
     }
 
-    static inline double _scurve(double t)
+    static inline float _scurve(float t)
     {
-        return t * t * (3.0 - 2.0 * t);
+        return t * t * (3.0f - 2.0f * t);
     }
 
-    static inline double _lerp(double t, double a, double b)
+    static inline float _lerp(float t, float a, float b)
     {
         return a + t * (b - a);
     }
@@ -297,7 +298,7 @@ private:
     Geom::Rect _tile;
     Geom::Point _baseFreq;
     int _latticeSelector[2 * BSize + 2];
-    double _gradient[2 * BSize + 2][4][2];
+    float _gradient[2 * BSize + 2][2][4]; // [lattice point][dimension][channel]
     long _seed;
     int _octaves;
     bool _stitchTiles;
@@ -309,8 +310,113 @@ private:
     bool _fractalnoise;
 };
 
+namespace {
+
+/**
+ * The results kept by all turbulence primitives together, in least-recently-used order, so that
+ * many turbulence filters on screen cannot hold on to an unbounded amount of memory.
+ */
+struct TurbulenceCacheList
+{
+    std::mutex mutex;
+    std::list<TurbulenceCache *> caches; ///< Most recently used first.
+    std::size_t size = 0;                ///< Bytes held by all results.
+};
+
+TurbulenceCacheList &cache_list()
+{
+    static TurbulenceCacheList list;
+    return list;
+}
+
+// Do not keep more than this many bytes of results in total.
+constexpr std::size_t TURBULENCE_CACHE_BUDGET = std::size_t{64} << 20;
+
+} // namespace
+
+/**
+ * The last result of a FilterTurbulence. Turbulence only depends on the position of a pixel, so
+ * as long as the transform stays the same, the pixels that were already computed can be copied
+ * over and only the newly exposed ones need to be synthesized, which makes panning cheap.
+ *
+ * A stored result is never modified, so it can be copied from without holding any lock once a
+ * reference to it has been taken.
+ */
+class TurbulenceCache
+{
+public:
+    ~TurbulenceCache() { clear(); }
+
+    /// Return a new reference to the last result and where it starts, if it was rendered with trans.
+    cairo_surface_t *lookup(Geom::Affine const &trans, Geom::IntPoint &origin)
+    {
+        auto &list = cache_list();
+        auto lock = std::lock_guard(list.mutex);
+        if (!_surface || _trans != trans) {
+            return nullptr;
+        }
+        list.caches.splice(list.caches.begin(), list.caches, _pos);
+        origin = _origin;
+        return cairo_surface_reference(_surface);
+    }
+
+    /// Replace the last result, then evict the least recently used results while over budget.
+    void store(cairo_surface_t *surface, Geom::Affine const &trans, Geom::IntPoint const &origin)
+    {
+        auto &list = cache_list();
+        auto lock = std::lock_guard(list.mutex);
+        _clear(list);
+
+        auto const size = static_cast<std::size_t>(cairo_image_surface_get_stride(surface))
+                        * cairo_image_surface_get_height(surface);
+        if (size > TURBULENCE_CACHE_BUDGET / 4) {
+            return;
+        }
+
+        _surface = cairo_surface_reference(surface);
+        _trans = trans;
+        _origin = origin;
+        _size = size;
+        list.caches.push_front(this);
+        _pos = list.caches.begin();
+        list.size += size;
+
+        while (list.size > TURBULENCE_CACHE_BUDGET) {
+            list.caches.back()->_clear(list);
+        }
+    }
+
+    void clear()
+    {
+        auto &list = cache_list();
+        auto lock = std::lock_guard(list.mutex);
+        _clear(list);
+    }
+
+    std::mutex mutex; ///< Guards initialising the generator.
+
+private:
+    cairo_surface_t *_surface = nullptr;
+    Geom::Affine _trans;
+    Geom::IntPoint _origin;
+    std::size_t _size = 0;
+    std::list<TurbulenceCache *>::iterator _pos; ///< Position in the list, if a result is kept.
+
+    // Called with the list locked.
+    void _clear(TurbulenceCacheList &list)
+    {
+        if (_surface) {
+            cairo_surface_destroy(_surface);
+            _surface = nullptr;
+            list.caches.erase(_pos);
+            list.size -= _size;
+        }
+    }
+};
+
 FilterTurbulence::FilterTurbulence()
     : gen(std::make_unique<TurbulenceGenerator>())
+    , cache(std::make_unique<TurbulenceCache>())
     , XbaseFrequency(0)
     , YbaseFrequency(0)
     , numOctaves(1)
@@ -329,56 +435,85 @@ void FilterTurbulence::set_baseFrequency(int axis, double freq)
 {
     if (axis == 0) XbaseFrequency = freq;
     if (axis == 1) YbaseFrequency = freq;
-    gen->dirty();
+    invalidate();
 }
 
 void FilterTurbulence::set_numOctaves(int num)
 {
     numOctaves = num;
-    gen->dirty();
+    invalidate();
 }
 
 void FilterTurbulence::set_seed(double s)
 {
     seed = s;
-    gen->dirty();
+    invalidate();
 }
 
 void FilterTurbulence::set_stitchTiles(bool st)\
 {
     stitchTiles = st;
-    gen->dirty();
+    invalidate();
 }
 
 void FilterTurbulence::set_type(FilterTurbulenceType t)
 {
     type = t;
-    gen->dirty();
+    invalidate();
 }
 
 void FilterTurbulence::set_updated(bool /*u*/)
 {
 }
 
-struct Turbulence
+void FilterTurbulence::invalidate()
 {
-    Turbulence(TurbulenceGenerator const &gen, Geom::Affine const &trans, int x0, int y0)
-        : _gen(gen)
-        , _trans(trans)
-        , _x0(x0), _y0(y0) {}
+    gen->dirty();
+    cache->clear();
+}
 
-    guint32 operator()(int x, int y)
-    {
-        Geom::Point point(x + _x0, y + _y0);
-        point *= _trans;
-        return _gen.turbulencePixel(point);
-    }
+void FilterTurbulence::drop_cache()
+{
+    cache->clear();
+}
 
-private:
-    TurbulenceGenerator const &_gen;
-    Geom::Affine _trans;
-    int _x0, _y0;
-};
+/**
+ * Fill the surface with turbulence, pixel (x, y) being taken at (x, y) + origin transformed by
+ * trans. Pixels within skip, also offset by origin, are left alone.
+ */
+static void synthesize_turbulence(cairo_surface_t *surface, TurbulenceGenerator const &gen,
+                                  Geom::Affine const &trans, Geom::IntPoint const &origin,
+                                  Geom::OptIntRect const &skip)
+{
+    cairo_surface_flush(surface);
+
+    int w = cairo_image_surface_get_width(surface);
+    int h = cairo_image_surface_get_height(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    unsigned char *data = cairo_image_surface_get_data(surface);
+
+    // Moving one pixel to the right moves by the first column of the transform.
+    Geom::Point const step(trans[0], trans[1]);
+
+    int limit = w * h;
+    ink_parallel_for(h, limit > PARALLEL_THRESHOLD, [&] (int y) {
+        auto row = reinterpret_cast<guint32 *>(data + y * stride);
+        auto const synth = [&] (int x0, int x1) {
+            if (x0 < x1) {
+                auto start = Geom::Point(x0 + origin.x(), y + origin.y()) * trans;
+                gen.turbulenceRow(start, step, x1 - x0, row + x0);
+            }
+        };
+        if (skip && y + origin.y() >= skip->top() && y + origin.y() < skip->bottom()) {
+            synth(0, std::clamp(skip->left() - origin.x(), 0, w));
+            synth(std::clamp(skip->right() - origin.x(), 0, w), w);
+        } else {
+            synth(0, w);
+        }
+    });
+
+    cairo_surface_mark_dirty(surface);
+}
 
 void FilterTurbulence::render_cairo(FilterSlot &slot) const
 {
@@ -401,19 +536,41 @@ void FilterTurbulence::render_cairo(FilterSlot &slot) const
     // color_interpolation_filter is determined by CSS value (see spec. Turbulence).
     set_cairo_surface_ci(out, color_interpolation);
 
-    if (!gen->ready()) {
-        Geom::Point ta(fTileX, fTileY);
-        Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
-        gen->init(seed, Geom::Rect(ta, tb),
-                  Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
-                  type == TURBULENCE_FRACTALNOISE, numOctaves);
-    }
-
     Geom::Affine unit_trans = slot.get_units().get_matrix_primitiveunits2pb().inverse();
     Geom::Rect slot_area = slot.get_slot_area();
-    double x0 = slot_area.min()[Geom::X];
-    double y0 = slot_area.min()[Geom::Y];
-    ink_cairo_surface_synthesize(temp, Turbulence(*gen, unit_trans, x0, y0));
+    Geom::IntPoint origin(static_cast<int>(slot_area.min()[Geom::X]), static_cast<int>(slot_area.min()[Geom::Y]));
+
+    {
+        auto lock = std::lock_guard(cache->mutex);
+        if (!gen->ready()) {
+            Geom::Point ta(fTileX, fTileY);
+            Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
+            gen->init(seed, Geom::Rect(ta, tb),
+                      Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
+                      type == TURBULENCE_FRACTALNOISE, numOctaves);
+        }
+    }
+
+    // Copy what can be reused from the last result, then synthesize the rest.
+    Geom::OptIntRect reused;
+    Geom::IntPoint cached_origin;
+    if (auto cached = cache->lookup(unit_trans, cached_origin)) {
+        auto const cached_rect = Geom::IntRect::from_xywh(cached_origin, {cairo_image_surface_get_width(cached),
+                                                                          cairo_image_surface_get_height(cached)});
+        reused = Geom::intersect(cached_rect, Geom::IntRect::from_xywh(origin, {width, height}));
+        if (reused) {
+            cairo_t *ct = cairo_create(temp);
+            cairo_set_source_surface(ct, cached, cached_origin.x() - origin.x(), cached_origin.y() - origin.y());
+            cairo_rectangle(ct, reused->left() - origin.x(), reused->top() - origin.y(), reused->width(), reused->height());
+            cairo_set_operator(ct, CAIRO_OPERATOR_SOURCE);
+            cairo_fill(ct);
+            cairo_destroy(ct);
+        }
+        cairo_surface_destroy(cached);
+    }
+
+    synthesize_turbulence(temp, *gen, unit_trans, origin, reused);
+    cache->store(temp, unit_trans, origin);
 
     // cairo_surface_write_to_png( temp, "turbulence0.png" );
 
@@ -40,6 +40,7 @@ enum FilterTurbulenceType
 };
 
 class TurbulenceGenerator;
+class TurbulenceCache;
 
 class FilterTurbulence : public FilterPrimitive
 {
@@ -50,6 +51,7 @@ public:
     void render_cairo(FilterSlot &slot) const override;
     double complexity(Geom::Affine const &ctm) const override;
     bool uses_background() const override { return false; }
+    void drop_cache() override;
 
     void set_baseFrequency(int axis, double freq);
     void set_numOctaves(int num);
@@ -62,8 +64,10 @@ public:
 
 private:
     std::unique_ptr<TurbulenceGenerator> gen;
+    std::unique_ptr<TurbulenceCache> cache;
 
     void turbulenceInit(long seed);
+    void invalidate();
 
     double XbaseFrequency, YbaseFrequency;
     int numOctaves;
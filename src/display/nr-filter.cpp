@@ -47,6 +47,7 @@
 #include <2geom/affine.h>
 #include <2geom/rect.h>
 #include "svg/svg-length.h"
+#include "ui/widget/canvas/framecheck.h"
 //#include "sp-filter-units.h"
 
 namespace Inkscape {
@@ -101,6 +102,11 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
     // std::cout << "Filter::render() for: " << const_cast<Inkscape::DrawingItem *>(item)->name() << std::endl;
     // std::cout << "  graphic drawing_scale: " << graphic.surface()->device_scale() << std::endl;
 
+    FrameCheck::Event fc_filter;
+    if (FrameCheck::is_recording()) {
+        fc_filter = FrameCheck::Event("filter");
+    }
+
     if (primitives.empty()) {
         // when no primitives are defined, clear source graphic
         graphic.setSource(0,0,0,0);
@@ -152,6 +158,10 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
     auto slot = FilterSlot(bgdc, graphic, units, rc, blurquality);
 
     for (auto &i : primitives) {
+        FrameCheck::Event fc;
+        if (FrameCheck::is_recording()) {
+            fc = FrameCheck::Event("filter-primitive", i->name().raw());
+        }
         i->render_cairo(slot);
     }
 
@@ -307,6 +317,13 @@ void Filter::clear_primitives()
     primitives.clear();
 }
 
+void Filter::drop_cache()
+{
+    for (auto &primitive : primitives) {
+        primitive->drop_cache();
+    }
+}
+
 void Filter::set_x(SVGLength const &length)
 {
   if (length._set)
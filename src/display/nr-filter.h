@@ -60,6 +60,12 @@ public:
      */
     void clear_primitives();
 
+    /**
+     * Releases the results that filter primitives keep from earlier renders
+     * to speed up the next one.
+     */
+    void drop_cache();
+
     /**
      * Sets the slot number 'slot' to be used as result from this filter.
      * If output is not set, the output from last filter primitive is used as
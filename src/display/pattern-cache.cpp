@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Rendered pattern tiles shared between the users of a pattern.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "pattern-cache.h"
+
+#include <boost/functional/hash.hpp>
+
+namespace Inkscape {
+
+namespace {
+
+void hash_affine(std::size_t &seed, Geom::Affine const &affine)
+{
+    for (int i = 0; i < 6; i++) {
+        boost::hash_combine(seed, affine[i]);
+    }
+}
+
+} // namespace
+
+PatternCache::Surface::Surface(Geom::IntRect const &rect, int device_scale)
+    : rect(rect)
+    , surface(Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, rect.width() * device_scale, rect.height() * device_scale))
+{
+    cairo_surface_set_device_scale(surface->cobj(), device_scale, device_scale);
+}
+
+std::size_t PatternCache::Tiles::size() const
+{
+    std::size_t result = 0;
+    for (auto const &s : surfaces) {
+        result += static_cast<std::size_t>(s.surface->get_stride()) * s.surface->get_height();
+    }
+    return result;
+}
+
+bool PatternCache::Params::operator==(Params const &other) const
+{
+    return tile_rect == other.tile_rect
+        && child_transform == other.child_transform
+        && resolution == other.resolution
+        && overflow_initial_transform == other.overflow_initial_transform
+        && overflow_step_transform == other.overflow_step_transform
+        && overflow_steps == other.overflow_steps
+        && opacity == other.opacity
+        && antialias == other.antialias
+        && blend_mode == other.blend_mode
+        && isolation == other.isolation;
+}
+
+bool PatternCache::Key::operator==(Key const &other) const
+{
+    return content == other.content
+        && params == other.params
+        && device_scale == other.device_scale
+        && antialias == other.antialias;
+}
+
+std::size_t PatternCache::KeyHash::operator()(Key const &key) const
+{
+    std::size_t seed = key.content;
+    auto const &p = key.params;
+    for (int i = 0; i < 2; i++) {
+        boost::hash_combine(seed, p.tile_rect[i].min());
+        boost::hash_combine(seed, p.tile_rect[i].max());
+        boost::hash_combine(seed, p.resolution[i]);
+    }
+    hash_affine(seed, p.child_transform);
+    hash_affine(seed, p.overflow_initial_transform);
+    hash_affine(seed, p.overflow_step_transform);
+    boost::hash_combine(seed, p.overflow_steps);
+    boost::hash_combine(seed, p.opacity);
+    boost::hash_combine(seed, p.antialias);
+    boost::hash_combine(seed, p.blend_mode);
+    boost::hash_combine(seed, p.isolation);
+    boost::hash_combine(seed, key.device_scale);
+    boost::hash_combine(seed, key.antialias);
+    return seed;
+}
+
+std::shared_ptr<PatternCache::Tiles> PatternCache::get(Key const &key)
+{
+    auto lock = std::lock_guard(_mutex);
+    if (auto it = _index.find(key); it != _index.end()) {
+        _records.splice(_records.begin(), _records, it->second);
+        return it->second->tiles;
+    }
+    _records.push_front({key, std::make_shared<Tiles>()});
+    _index.emplace(key, _records.begin());
+    return _records.front().tiles;
+}
+
+void PatternCache::setSize(Key const &key, std::size_t bytes)
+{
+    auto lock = std::lock_guard(_mutex);
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        return; // Dropped while rendering.
+    }
+    _size += bytes;
+    _size -= it->second->size;
+    it->second->size = bytes;
+
+    // Evict, but never the tiles that were just rendered.
+    while (_size > _budget && _records.size() > 1 && std::prev(_records.end()) != it->second) {
+        _erase(std::prev(_records.end()));
+    }
+}
+
+void PatternCache::drop(std::uintptr_t content)
+{
+    auto lock = std::lock_guard(_mutex);
+    for (auto it = _records.begin(); it != _records.end(); ) {
+        auto next = std::next(it);
+        if (it->key.content == content) {
+            _erase(it);
+        }
+        it = next;
+    }
+}
+
+void PatternCache::clear()
+{
+    auto lock = std::lock_guard(_mutex);
+    _records.clear();
+    _index.clear();
+    _size = 0;
+}
+
+void PatternCache::_erase(std::list<Record>::iterator it)
+{
+    // Anyone still rendering from the tiles keeps them alive through their shared_ptr.
+    _size -= it->size;
+    _index.erase(it->key);
+    _records.erase(it);
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Rendered pattern tiles shared between the users of a pattern.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef INKSCAPE_DISPLAY_PATTERN_CACHE_H
+#define INKSCAPE_DISPLAY_PATTERN_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cairomm/surface.h>
+#include <2geom/affine.h>
+#include <2geom/int-point.h>
+#include <2geom/int-rect.h>
+#include <2geom/rect.h>
+
+namespace Inkscape {
+
+/**
+ * @brief Rendered tiles of the patterns and hatches in a Drawing.
+ *
+ * Every item filled or stroked with a pattern gets its own DrawingPattern, but many of them show
+ * exactly the same tile: objects given a pattern in the UI all reference one root pattern, and
+ * only differ by the transform placing the tile in user space. So rather than each DrawingPattern
+ * keeping its own rendering, the rendered parts of a tile are kept here, keyed by the content and
+ * everything that affects how the tile is rasterised, and shared by all DrawingPatterns for which
+ * these agree. Tiles are evicted in least-recently-used order once over budget.
+ */
+class PatternCache
+{
+public:
+    /// A rendered part of a tile.
+    struct Surface
+    {
+        Surface(Geom::IntRect const &rect, int device_scale);
+        Geom::IntRect rect;
+        Cairo::RefPtr<Cairo::ImageSurface> surface;
+    };
+
+    /// The rendered parts of one tile. Must only be accessed with the mutex held.
+    struct Tiles
+    {
+        std::mutex mutex;
+        std::vector<Surface> surfaces;
+
+        std::size_t size() const;
+    };
+
+    /// How a tile is rasterised; everything apart from its content that can change its pixels.
+    struct Params
+    {
+        Geom::Rect tile_rect;
+        Geom::Affine child_transform;
+        Geom::IntPoint resolution;
+        Geom::Affine overflow_initial_transform;
+        Geom::Affine overflow_step_transform;
+        int overflow_steps = 1;
+
+        // Style of the pattern item itself.
+        float opacity = 1.0;
+        int antialias = 0;
+        int blend_mode = 0;
+        bool isolation = false;
+
+        bool operator==(Params const &other) const;
+    };
+
+    struct Key
+    {
+        std::uintptr_t content;
+        Params params;
+        int device_scale;
+        int antialias; ///< Antialiasing override, or -1 for none.
+
+        bool operator==(Key const &other) const;
+    };
+
+    PatternCache() = default;
+    PatternCache(PatternCache const &) = delete;
+    PatternCache &operator=(PatternCache const &) = delete;
+
+    /// Get the tiles for the given key, creating them if they don't exist yet.
+    std::shared_ptr<Tiles> get(Key const &key);
+
+    /// Update the memory used by the tiles for the given key, after rendering to them.
+    void setSize(Key const &key, std::size_t bytes);
+
+    /// Forget all tiles with the given content, because it changed.
+    void drop(std::uintptr_t content);
+    void clear();
+
+private:
+    struct KeyHash
+    {
+        std::size_t operator()(Key const &key) const;
+    };
+
+    struct Record
+    {
+        Key key;
+        std::shared_ptr<Tiles> tiles;
+        std::size_t size = 0;
+    };
+
+    void _erase(std::list<Record>::iterator it);
+
+    std::mutex _mutex;
+    std::list<Record> _records; ///< Most recently used first.
+    std::unordered_map<Key, std::list<Record>::iterator, KeyHash> _index;
+    std::size_t _size = 0;
+    std::size_t _budget = std::size_t{64} << 20;
+};
+
+} // namespace Inkscape
+
+#endif // INKSCAPE_DISPLAY_PATTERN_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
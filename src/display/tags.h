@@ -52,6 +52,18 @@ DRAWINGITEM_HIERARCHY_DATA(X)
 DRAWINGITEM_HIERARCHY_DATA(X)
 #undef X
 
+// Class names, indexed by tag (for debugging and profiling output)
+
+namespace Inkscape {
+
+inline constexpr char const *drawingitem_tag_names[] = {
+    #define X(n, ...) #n, __VA_ARGS__
+    DRAWINGITEM_HIERARCHY_DATA(X)
+    #undef X
+};
+
+} // namespace Inkscape
+
 #undef DRAWINGITEM_HIERARCHY_DATA
 
 #endif // INKSCAPE_DRAWINGITEM_TAGS_H
@@ -38,6 +38,7 @@
 
 #include "document.h"
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -80,6 +81,7 @@
 #include "object/sp-page.h"
 #include "object/sp-root.h"
 #include "object/sp-symbol.h"
+#include "object/sp-text.h"
 #include "ui/widget/canvas.h"
 #include "ui/widget/desktop-widget.h"
 #include "xml/croco-node-iface.h"
@@ -349,6 +351,57 @@ void SPDocument::collectOrphans() {
     }
 }
 
+/**
+ * Called by a text during the update pass, once it has built its layout input. Returns true if
+ * the text should leave calculating the flow to the document, which then does it together with
+ * all other queued texts at the end of the pass (see _flushTextLayouts()).
+ *
+ * This is only allowed while nothing is displaying the document, such as when it is being
+ * loaded, since otherwise other objects may want the text's bounding box during the pass.
+ */
+bool SPDocument::queueTextLayout(SPText *text)
+{
+    if (!_batch_text_layouts || !text->views.empty()) {
+        return false;
+    }
+
+    sp_object_ref(text, nullptr);
+    _text_layout_queue.push_back(text);
+    return true;
+}
+
+/**
+ * Calculate the flows of all queued texts, in parallel, and let each text finish its layout.
+ */
+void SPDocument::_flushTextLayouts()
+{
+    if (_text_layout_queue.empty()) {
+        return;
+    }
+
+    auto texts = std::move(_text_layout_queue);
+    _text_layout_queue.clear();
+
+    // A layout must not be calculated twice at once.
+    auto unique_texts = texts;
+    std::sort(unique_texts.begin(), unique_texts.end());
+    unique_texts.erase(std::unique(unique_texts.begin(), unique_texts.end()), unique_texts.end());
+
+    std::vector<Inkscape::Text::Layout *> layouts;
+    layouts.reserve(unique_texts.size());
+    for (auto text : unique_texts) {
+        layouts.push_back(&text->layout);
+    }
+    Inkscape::Text::Layout::calculateFlows(layouts);
+
+    for (auto text : unique_texts) {
+        text->finishLayout();
+    }
+    for (auto text : texts) {
+        sp_object_unref(text, nullptr);
+    }
+}
+
 SPDocument *SPDocument::createDoc(Inkscape::XML::Document *rdoc,
                                   gchar const *filename,
                                   gchar const *document_base,
@@ -1409,7 +1462,10 @@ SPDocument::_updateDocument(int update_flags)
 
             DocumentUndo::ScopedInsensitive _no_undo(this);
 
+            _batch_text_layouts = root->views.empty();
             this->root->updateDisplay((SPCtx *)&ctx, update_flags);
+            _batch_text_layouts = false;
+            _flushTextLayouts();
         }
         this->_emitModified();
     }
@@ -74,6 +74,7 @@ class SPItem;
 class SPObject;
 class SPGroup;
 class SPRoot;
+class SPText;
 class SPNamedView;
 
 namespace Inkscape {
@@ -155,6 +156,7 @@ public:
     bool isModifiedSinceAutoSave() const { return modified_since_autosave; }
     void setModifiedSinceSave(bool const modified = true);
     void setModifiedSinceAutoSaveFalse() { modified_since_autosave = false; };
+    void setModifiedSinceAutoSaveTrue() { modified_since_autosave = true; };
 
     bool idle_handler();
     bool rerouting_handler();
@@ -365,6 +367,9 @@ public:
     void queueForOrphanCollection(SPObject *object);
     void collectOrphans();
 
+    // Batched text layout ---------------------
+    bool queueTextLayout(SPText *text);
+
 
     // Actions ---------------------------------
     Glib::RefPtr<Gio::SimpleActionGroup> getActionGroup() { return action_group; }
@@ -449,6 +454,12 @@ private:
 
     std::vector<SPObject *> _collection_queue; ///< Orphans
 
+    // Batched text layout ---------------------
+
+    bool _batch_text_layouts = false; ///< Whether texts may queue their layout during this update pass
+    std::vector<SPText *> _text_layout_queue;
+    void _flushTextLayouts();
+
     // Actions ---------------------------------
     Glib::RefPtr<Gio::SimpleActionGroup> action_group;
 
@@ -138,6 +138,9 @@ CairoRenderContext::~CairoRenderContext()
 {
     for (std::map<gpointer, cairo_font_face_t *>::const_iterator iter = font_table.begin(); iter != font_table.end(); ++iter)
         font_data_free(iter->second);
+    for (auto const &[image, id] : _image_ids) {
+        cairo_surface_destroy(image);
+    }
 
     if (_cr) cairo_destroy(_cr);
     if (_surface) cairo_surface_destroy(_surface);
@@ -1195,9 +1198,6 @@ CairoRenderContext::_createPatternPainter(SPPaintServer const *const paintserver
     double surface_width = MAX(ceil(SUBPIX_SCALE * bbox_width_scaler * width - 0.5), 1);
     double surface_height = MAX(ceil(SUBPIX_SCALE * bbox_height_scaler * height - 0.5), 1);
     TRACE(("pattern surface size: %f x %f\n", surface_width, surface_height));
-    // create new rendering context
-    CairoRenderContext *pattern_ctx = cloneMe(surface_width, surface_height);
-
     // adjust the size of the painted pattern to fit exactly the created surface
     // this has to be done because of the rounding to obtain an integer pattern surface width/height
     double scale_width = surface_width / (bbox_width_scaler * width);
@@ -1212,31 +1212,60 @@ CairoRenderContext::_createPatternPainter(SPPaintServer const *const paintserver
     ps2user[4] = ori[Geom::X];
     ps2user[5] = ori[Geom::Y];
 
-    pattern_ctx->setTransform(pcs2dev);
-    pattern_ctx->pushState();
+    // Every object painted with this pattern at this size shares the tile, so that it is only
+    // written once to PDF and PS files.
+    auto const key = CairoRenderer::SurfaceKey{pat, cairo_surface_get_type(cairo_get_target(_cr)), {},
+                                               {surface_width, surface_height, pcs2dev[0], pcs2dev[1],
+                                                pcs2dev[2], pcs2dev[3], pcs2dev[4], pcs2dev[5]}};
+    auto const shared = _renderer->getSharedSurface(key);
+    cairo_surface_t *pattern_surface = shared ? shared->surface : nullptr;
+
+    if (!pattern_surface) {
+        // create new rendering context
+        CairoRenderContext *pattern_ctx = cloneMe(surface_width, surface_height);
+
+        pattern_ctx->setTransform(pcs2dev);
+        pattern_ctx->pushState();
+
+        // create drawing and group
+        Inkscape::Drawing drawing;
+        unsigned dkey = SPItem::display_key_new(1);
+
+        // show items and render them
+        for (SPPattern *pat_i = pat; pat_i != nullptr; pat_i = pat_i->ref.getObject()) {
+            if (pat_i && pattern_hasItemChildren(pat_i)) { // find the first one with item children
+                for (auto& child: pat_i->children) {
+                    if (is<SPItem>(&child)) {
+                        cast<SPItem>(&child)->invoke_show(drawing, dkey, SP_ITEM_REFERENCE_FLAGS);
+                        _renderer->renderItem(pattern_ctx, cast<SPItem>(&child));
+                    }
+                }
+                break; // do not go further up the chain if children are found
+            }
+        }
 
-    // create drawing and group
-    Inkscape::Drawing drawing;
-    unsigned dkey = SPItem::display_key_new(1);
+        pattern_ctx->popState();
+
+        pattern_surface = pattern_ctx->getSurface();
+        TEST(pattern_ctx->saveAsPng("pattern.png"));
+        _renderer->setSharedSurface(key, pattern_surface);
 
-    // show items and render them
-    for (SPPattern *pat_i = pat; pat_i != nullptr; pat_i = pat_i->ref.getObject()) {
-        if (pat_i && pattern_hasItemChildren(pat_i)) { // find the first one with item children
-            for (auto& child: pat_i->children) {
-                if (is<SPItem>(&child)) {
-                    cast<SPItem>(&child)->invoke_show(drawing, dkey, SP_ITEM_REFERENCE_FLAGS);
-                    _renderer->renderItem(pattern_ctx, cast<SPItem>(&child));
+        delete pattern_ctx;
+
+        // hide all items
+        for (SPPattern *pat_i = pat; pat_i != nullptr; pat_i = pat_i->ref.getObject()) {
+            if (pat_i && pattern_hasItemChildren(pat_i)) { // find the first one with item children
+                for (auto& child: pat_i->children) {
+                    if (is<SPItem>(&child)) {
+                        cast<SPItem>(&child)->invoke_hide(dkey);
+                    }
                 }
+                break; // do not go further up the chain if children are found
             }
-            break; // do not go further up the chain if children are found
         }
     }
 
-    pattern_ctx->popState();
-
     // setup a cairo_pattern_t
-    cairo_surface_t *pattern_surface = pattern_ctx->getSurface();
-    TEST(pattern_ctx->saveAsPng("pattern.png"));
     cairo_pattern_t *result = cairo_pattern_create_for_surface(pattern_surface);
     cairo_pattern_set_extend(result, CAIRO_EXTEND_REPEAT);
 
@@ -1246,20 +1275,6 @@ CairoRenderContext::_createPatternPainter(SPPaintServer const *const paintserver
     cairo_matrix_invert(&pattern_matrix);
     cairo_pattern_set_matrix(result, &pattern_matrix);
 
-    delete pattern_ctx;
-
-    // hide all items
-    for (SPPattern *pat_i = pat; pat_i != nullptr; pat_i = pat_i->ref.getObject()) {
-        if (pat_i && pattern_hasItemChildren(pat_i)) { // find the first one with item children
-            for (auto& child: pat_i->children) {
-                if (is<SPItem>(&child)) {
-                    cast<SPItem>(&child)->invoke_hide(dkey);
-                }
-            }
-            break; // do not go further up the chain if children are found
-        }
-    }
-
     return result;
 }
 
@@ -1739,13 +1754,19 @@ bool CairoRenderContext::renderImage(Inkscape::Pixbuf const *pb,
         return false;
     }
 
+    // Let PDF and PS surfaces write identical images only once, even when they come from
+    // different files or data URIs. The Pixbuf's surface is shared with the canvas, so they are
+    // given a surface of their own to mark.
+    auto const surface = _vector_based_target ? _createUniqueImage(const_cast<cairo_surface_t*>(image_surface))
+                                              : cairo_surface_reference(const_cast<cairo_surface_t*>(image_surface));
+
     cairo_save(_cr);
 
     // scaling by width & height is not needed because it will be done by Cairo
     transform(image_transform);
 
-    // cairo_set_source_surface only modifies refcount of 'image_surface', which is an implementation detail
-    cairo_set_source_surface(_cr, const_cast<cairo_surface_t*>(image_surface), 0.0, 0.0);
+    cairo_set_source_surface(_cr, surface, 0.0, 0.0);
+    cairo_surface_destroy(surface);
 
     // set clip region so that the pattern will not be repeated (bug in Cairo-PDF)
     if (_vector_based_target) {
@@ -1789,6 +1810,92 @@ bool CairoRenderContext::renderImage(Inkscape::Pixbuf const *pb,
     return true;
 }
 
+/**
+ * Create a surface showing the same pixels and encoded data as image, marked with an id derived
+ * from them. Nothing is attached to image itself, since it may be rendered on the canvas at the
+ * same time; the new surface keeps it alive for as long as it uses its data.
+ */
+cairo_surface_t *CairoRenderContext::_createUniqueImage(cairo_surface_t *image)
+{
+    static cairo_user_data_key_t const image_key{};
+
+    // Not flushed first, since that would drop the encoded data.
+    auto const data = cairo_image_surface_get_data(image);
+    auto const format = cairo_image_surface_get_format(image);
+    int const width = cairo_image_surface_get_width(image);
+    int const height = cairo_image_surface_get_height(image);
+    int const stride = cairo_image_surface_get_stride(image);
+
+    auto const surface = cairo_image_surface_create_for_data(data, format, width, height, stride);
+    cairo_surface_set_user_data(surface, &image_key, cairo_surface_reference(image),
+                                reinterpret_cast<cairo_destroy_func_t>(cairo_surface_destroy));
+
+    // When encoded data is attached, that is what gets written, so that is what identifies it.
+    auto [it, inserted] = _image_ids.try_emplace(image);
+    if (inserted) {
+        cairo_surface_reference(image);
+    }
+    auto &id = it->second;
+    auto checksum = inserted ? g_checksum_new(G_CHECKSUM_SHA256) : nullptr;
+    for (auto mimetype : {CAIRO_MIME_TYPE_JPEG, CAIRO_MIME_TYPE_JP2, CAIRO_MIME_TYPE_PNG}) {
+        unsigned char const *mime_data = nullptr;
+        unsigned long length = 0;
+        cairo_surface_get_mime_data(image, mimetype, &mime_data, &length);
+        if (!mime_data) {
+            continue;
+        }
+        // Owned by image, which outlives the new surface.
+        cairo_surface_set_mime_data(surface, mimetype, mime_data, length, nullptr, nullptr);
+        if (checksum) {
+            g_checksum_update(checksum, reinterpret_cast<guchar const *>(mimetype), -1);
+            g_checksum_update(checksum, mime_data, length);
+        }
+    }
+    if (checksum) {
+        int const dims[] = {format, width, height};
+        g_checksum_update(checksum, reinterpret_cast<guchar const *>(dims), sizeof(dims));
+        g_checksum_update(checksum, data, std::size_t(height) * stride);
+        id = std::string("inkscape-image-") + g_checksum_get_string(checksum);
+        g_checksum_free(checksum);
+    }
+
+    auto copy = g_strndup(id.data(), id.size());
+    cairo_surface_set_mime_data(surface, CAIRO_MIME_TYPE_UNIQUE_ID, reinterpret_cast<unsigned char *>(copy), id.size(), g_free, copy);
+    return surface;
+}
+
+bool CairoRenderContext::renderSurface(cairo_surface_t *surface, Geom::Affine const &surface_transform)
+{
+    g_assert( _is_valid );
+
+    if (_render_mode == RENDER_MODE_CLIP) {
+        return true;
+    }
+
+    _prepareRenderGraphic();
+
+    cairo_save(_cr);
+
+    cairo_matrix_t matrix;
+    _initCairoMatrix(&matrix, surface_transform);
+    cairo_transform(_cr, &matrix);
+
+    cairo_set_source_surface(_cr, surface, 0.0, 0.0);
+
+    // as in renderImage(), clip so that the pattern will not be repeated
+    cairo_rectangle_t extents;
+    if (cairo_surface_get_type(surface) == CAIRO_SURFACE_TYPE_RECORDING && cairo_recording_surface_get_extents(surface, &extents)) {
+        cairo_new_path(_cr);
+        cairo_rectangle(_cr, extents.x, extents.y, extents.width, extents.height);
+        cairo_clip(_cr);
+    }
+
+    cairo_paint(_cr);
+
+    cairo_restore(_cr);
+    return true;
+}
+
 #define GLYPH_ARRAY_SIZE 64
 
 // TODO investigate why the font is being ignored:
@@ -15,6 +15,7 @@
  */
 
 #include "extension/extension.h"
+#include <map>
 #include <set>
 #include <string>
 
@@ -174,6 +175,8 @@ public:
     bool renderPathVector(Geom::PathVector const &pathv, SPStyle const *style, Geom::OptRect const &pbox, CairoPaintOrder order = STROKE_OVER_FILL);
     bool renderImage(Inkscape::Pixbuf const *pb,
                      Geom::Affine const &image_transform, SPStyle const *style);
+    /** Paint the whole of a surface, such as one made through cloneMe(), placed by the given transform. */
+    bool renderSurface(cairo_surface_t *surface, Geom::Affine const &surface_transform);
     bool renderGlyphtext(PangoFont *font, Geom::Affine const &font_matrix,
                          std::vector<CairoGlyphInfo> const &glyphtext, SPStyle const *style,
                          bool second_pass = false);
@@ -249,9 +252,13 @@ protected:
     void _concatTransform(cairo_t *cr, Geom::Affine const &transform);
 
     void _prepareRenderGraphic();
+    cairo_surface_t *_createUniqueImage(cairo_surface_t *image);
     void _prepareRenderText();
 
     std::map<gpointer, cairo_font_face_t *> font_table;
+    /// Ids of the images shown so far, see _createUniqueImage(). Each image is referenced, so
+    /// that its address is not reused by another one while it is in here.
+    std::map<cairo_surface_t *, std::string> _image_ids;
     static void font_data_free(gpointer data);
 
     CairoRenderState *_createState();
@@ -26,6 +26,7 @@
 #endif
 
 
+#include <algorithm>
 #include <csignal>
 #include <cerrno>
 
@@ -49,6 +50,7 @@
 #include "document.h"
 #include "inkscape-version.h"
 #include "rdf.h"
+#include "style.h"
 #include "style-internal.h"
 #include "display/cairo-utils.h"
 #include "display/curve.h"
@@ -99,6 +101,8 @@ CairoRenderer::CairoRenderer(void)
 
 CairoRenderer::~CairoRenderer()
 {
+    _clearSharedSurfaces();
+
     /* restore default signal handling for SIGPIPE */
 #if !defined(_WIN32) && !defined(__WIN32__)
     (void) signal(SIGPIPE, SIG_DFL);
@@ -394,7 +398,7 @@ static void sp_use_render(SPUse *use, CairoRenderContext *ctx, SPPage *page)
         translated = true;
     }
 
-    if (use->child) {
+    if (use->child && !renderer->renderCloneInstance(ctx, use)) {
         // Padding in the use object as the origin here ensures markers
         // are rendered with their correct context-fill.
         renderer->renderItem(ctx, use->child, use, page);
@@ -677,6 +681,86 @@ CairoRenderer::setStateForItem(CairoRenderContext *ctx, SPItem const *item)
     TRACE(("setStateForItem opacity: %f\n", state->opacity));
 }
 
+/**
+ * Whether the rendering of an object and its descendants can be recorded once and painted in
+ * several places. Links have to be tagged on the page itself, and filters rendered as bitmaps
+ * depend on where the item is on the page.
+ */
+static bool sp_object_is_shareable(SPObject const *object, bool filter_to_bitmap)
+{
+    if (is<SPAnchor>(object)) {
+        return false;
+    }
+    if (auto item = cast<SPItem>(object); item && filter_to_bitmap && item->isFiltered()) {
+        return false;
+    }
+    for (auto const &child : object->children) {
+        if (!sp_object_is_shareable(&child, filter_to_bitmap)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CairoRenderer::renderCloneInstance(CairoRenderContext *ctx, SPUse *use)
+{
+    // Only worthwhile where painting a surface again refers to what was already written, and where
+    // the original has other clones to share it with.
+    auto const original = use->get_original();
+    if (!ctx->_vector_based_target || ctx->_render_mode != CairoRenderContext::RENDER_MODE_NORMAL ||
+        ctx->_is_omittext || !original || original->hrefcount < 2 ||
+        !sp_object_is_shareable(use->child, ctx->_is_filtertobitmap))
+    {
+        return false;
+    }
+
+    // The cloned objects inherit the style of the clone, and its size for symbols. The contents
+    // are recorded in a space with the linear part of the current transform, so clones that only
+    // differ by translation share them.
+    auto const linear = ctx->getTransform().withoutTranslation();
+    if (linear.isSingular()) {
+        return false;
+    }
+    auto const key = SurfaceKey{original, cairo_surface_get_type(cairo_get_target(ctx->_cr)),
+                                use->style->write(SP_STYLE_FLAG_ALWAYS).raw(),
+                                {linear[0], linear[1], linear[2], linear[3], use->width.computed, use->height.computed}};
+
+    cairo_surface_t *surface = nullptr;
+    Geom::Point origin;
+
+    if (auto shared = getSharedSurface(key)) {
+        surface = shared->surface;
+        origin = shared->origin;
+    } else {
+        auto bounds = use->child->visualBounds(use->child->transform * linear);
+        if (!bounds) {
+            return true; // Nothing to render.
+        }
+        // Recording surfaces cost nothing for their size, so leave plenty of room for anything the
+        // visual bounds do not account for, such as long miters.
+        bounds->expandBy(std::max(bounds->width(), bounds->height()) + 1.0);
+        origin = bounds->min().floor();
+        auto const size = bounds->max().ceil() - origin;
+
+        CairoRenderContext *instance_ctx = ctx->cloneMe(size.x(), size.y());
+        instance_ctx->_vector_based_target = ctx->_vector_based_target;
+        instance_ctx->_is_texttopath = ctx->_is_texttopath;
+        instance_ctx->_is_filtertobitmap = ctx->_is_filtertobitmap;
+        instance_ctx->_bitmapresolution = ctx->_bitmapresolution;
+        instance_ctx->setTransform(linear * Geom::Translate(-origin));
+        instance_ctx->pushState();
+        renderItem(instance_ctx, use->child, use);
+        instance_ctx->popState();
+
+        surface = instance_ctx->getSurface();
+        setSharedSurface(key, surface, origin);
+        destroyContext(instance_ctx);
+    }
+
+    ctx->renderSurface(surface, (linear * Geom::Translate(-origin)).inverse());
+    return true;
+}
+
 bool CairoRenderer::_shouldRasterize(CairoRenderContext *ctx, SPItem const *item)
 {
     // rasterize filtered items as per user setting
@@ -800,6 +884,30 @@ void CairoRenderer::setMetadata(CairoRenderContext *ctx, SPDocument *doc) {
     // mdate (currently unused)
 }
 
+auto CairoRenderer::getSharedSurface(SurfaceKey const &key) const -> SharedSurface const *
+{
+    auto it = _shared_surfaces.find(key);
+    return it != _shared_surfaces.end() ? &it->second : nullptr;
+}
+
+void CairoRenderer::setSharedSurface(SurfaceKey key, cairo_surface_t *surface, Geom::Point const &origin)
+{
+    cairo_surface_reference(surface);
+    auto [it, inserted] = _shared_surfaces.try_emplace(std::move(key), SharedSurface{surface, origin});
+    if (!inserted) {
+        cairo_surface_destroy(it->second.surface);
+        it->second = {surface, origin};
+    }
+}
+
+void CairoRenderer::_clearSharedSurfaces()
+{
+    for (auto &[key, shared] : _shared_surfaces) {
+        cairo_surface_destroy(shared.surface);
+    }
+    _shared_surfaces.clear();
+}
+
 bool
 CairoRenderer::setupDocument(CairoRenderContext *ctx, SPDocument *doc, SPItem *base)
 {
@@ -807,6 +915,9 @@ CairoRenderer::setupDocument(CairoRenderContext *ctx, SPDocument *doc, SPItem *b
 
     g_assert( ctx != nullptr );
 
+    // Shared surfaces are keyed by the objects they show, which belong to the document.
+    _clearSharedSurfaces();
+
     if (!base) {
         base = doc->getRoot();
     }
@@ -16,8 +16,12 @@
  */
 
 #include "extension/extension.h"
+#include <array>
+#include <map>
 #include <set>
 #include <string>
+#include <tuple>
+#include <2geom/point.h>
 
 //#include "libnrtype/font-instance.h"
 #include <cairo.h>
@@ -27,6 +31,7 @@ class SPClipPath;
 class SPMask;
 class SPHatchPath;
 class SPPage;
+class SPUse;
 
 namespace Inkscape {
 namespace Extension {
@@ -60,7 +65,40 @@ public:
     bool renderPages(CairoRenderContext *ctx, SPDocument *doc, bool stretch_to_fit);
     bool renderPage(CairoRenderContext *ctx, SPDocument *doc, SPPage *page, bool stretch_to_fit);
 
+    /** Render the contents of a clone by painting a surface shared with the identical clones
+    of the same original. Returns false if the clone has to be rendered directly instead. */
+    bool renderCloneInstance(CairoRenderContext *ctx, SPUse *use);
+
+    /** Identifies a surface rendered once and painted many times. */
+    struct SurfaceKey
+    {
+        void const *object;
+        cairo_surface_type_t target; ///< Type of the surface it will be painted on.
+        std::string style;
+        std::array<double, 8> params;
+
+        bool operator<(SurfaceKey const &other) const
+        {
+            return std::tie(object, target, style, params) < std::tie(other.object, other.target, other.style, other.params);
+        }
+    };
+
+    struct SharedSurface
+    {
+        cairo_surface_t *surface;
+        Geom::Point origin; ///< Position of the surface in the space its contents were rendered in.
+    };
+
+    /** Surfaces shared by everything painting the same content, such as the tiles of a pattern.
+    On PDF and PS targets, each is written to the file once, and referenced wherever painted. */
+    SharedSurface const *getSharedSurface(SurfaceKey const &key) const;
+    void setSharedSurface(SurfaceKey key, cairo_surface_t *surface, Geom::Point const &origin = {});
+
 private:
+    std::map<SurfaceKey, SharedSurface> _shared_surfaces;
+
+    void _clearSharedSurfaces();
+
     /** Extract metadata from doc and set it on ctx. */
     void setMetadata(CairoRenderContext *ctx, SPDocument *doc);
 
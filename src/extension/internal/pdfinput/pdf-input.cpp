@@ -666,6 +666,7 @@ PdfInput::open(::Inkscape::Extension::Input * /*mod*/, const gchar * uri) {
             // And then add each of the pages
             add_builder_page(pdf_doc, builder, doc, p);
         }
+        builder->finishImages();
 
         delete builder;
         g_free(docname);
@@ -16,9 +16,13 @@
 # include "config.h"  // only include where actually required!
 #endif
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <locale>
 #include <codecvt>
+#include <thread>
 
 #ifdef HAVE_POPPLER
 #define USE_CMS
@@ -85,6 +89,8 @@ SvgBuilder::SvgBuilder(SPDocument *document, gchar *docname, XRef *xref)
     // Set default preference settings
     _preferences = _xml_doc->createElement("svgbuilder:prefs");
     _preferences->setAttribute("embedImages", "1");
+
+    _pending_images = std::make_shared<std::deque<PendingImage>>();
 }
 
 SvgBuilder::SvgBuilder(SvgBuilder *parent, Inkscape::XML::Node *root) {
@@ -94,12 +100,16 @@ SvgBuilder::SvgBuilder(SvgBuilder *parent, Inkscape::XML::Node *root) {
     _xref = parent->_xref;
     _xml_doc = parent->_xml_doc;
     _preferences = parent->_preferences;
+    _pending_images = parent->_pending_images;
     _container = this->_root = root;
     _init();
 }
 
 SvgBuilder::~SvgBuilder()
 {
+    if (_is_top_level) {
+        finishImages();
+    }
     if (_clip_history) {
         delete _clip_history;
         _clip_history = nullptr;
@@ -1789,56 +1799,35 @@ void SvgBuilder::endTextObject(GfxState *state)
 void png_write_vector(png_structp png_ptr, png_bytep data, png_size_t length)
 {
     auto *v_ptr = reinterpret_cast<std::vector<guchar> *>(png_get_io_ptr(png_ptr)); // Get pointer to stream
-    for ( unsigned i = 0 ; i < length ; i++ ) {
-        v_ptr->push_back(data[i]);
-    }
+    v_ptr->insert(v_ptr->end(), data, data + length);
 }
 
 /**
- * \brief Creates an <image> element containing the given ImageStream as a PNG
- *
+ * Encode rows of pixels as a PNG, either 8-bit grey or BGRA with the alpha inverted as requested.
+ * Only uses its arguments, so it can run on any thread.
  */
-Inkscape::XML::Node *SvgBuilder::_createImage(Stream *str, int width, int height,
-                                              GfxImageColorMap *color_map, bool interpolate,
-                                              int *mask_colors, bool alpha_only,
-                                              bool invert_alpha) {
+static std::vector<guchar> encode_png(std::vector<guchar> const &pixels, int width, int height,
+                                      bool alpha_only, bool invert_alpha)
+{
+    std::vector<guchar> png_buffer;
 
     // Create PNG write struct
     png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
     if ( png_ptr == nullptr ) {
-        return nullptr;
+        return png_buffer;
     }
     // Create PNG info struct
     png_infop info_ptr = png_create_info_struct(png_ptr);
     if ( info_ptr == nullptr ) {
         png_destroy_write_struct(&png_ptr, nullptr);
-        return nullptr;
+        return png_buffer;
     }
     // Set error handler
     if (setjmp(png_jmpbuf(png_ptr))) {
         png_destroy_write_struct(&png_ptr, &info_ptr);
-        return nullptr;
-    }
-    // Decide whether we should embed this image
-    bool embed_image = _preferences->getAttributeBoolean("embedImages", true);
-
-    // Set read/write functions
-    std::vector<guchar> png_buffer;
-    FILE *fp = nullptr;
-    gchar *file_name = nullptr;
-    if (embed_image) {
-        png_set_write_fn(png_ptr, &png_buffer, png_write_vector, nullptr);
-    } else {
-        static int counter = 0;
-        file_name = g_strdup_printf("%s_img%d.png", _docname, counter++);
-        fp = fopen(file_name, "wb");
-        if ( fp == nullptr ) {
-            png_destroy_write_struct(&png_ptr, &info_ptr);
-            g_free(file_name);
-            return nullptr;
-        }
-        png_init_io(png_ptr, fp);
+        return {};
     }
+    png_set_write_fn(png_ptr, &png_buffer, png_write_vector, nullptr);
 
     // Set header data
     if ( !invert_alpha && !alpha_only ) {
@@ -1878,9 +1867,177 @@ Inkscape::XML::Node *SvgBuilder::_createImage(Stream *str, int width, int height
     // Write the file header
     png_write_info(png_ptr, info_ptr);
 
-    // Convert pixels
+    auto const row_size = std::size_t(width) * (alpha_only ? 1 : 4);
+    for ( int y = 0 ; y < height ; y++ ) {
+        png_write_row(png_ptr, const_cast<png_bytep>(pixels.data() + y * row_size));
+    }
+
+    // Close PNG
+    png_write_end(png_ptr, info_ptr);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    return png_buffer;
+}
+
+/**
+ * Whether JPEG data can be used as it is. JPEGs with Exif data are not, since PDF ignores the
+ * orientation they may specify, while gdk-pixbuf applies it.
+ */
+static bool jpeg_is_usable(std::vector<guchar> const &data)
+{
+    if (data.size() < 4 || data[0] != 0xff || data[1] != 0xd8) {
+        return false;
+    }
+    std::size_t pos = 2;
+    while (pos + 4 <= data.size() && data[pos] == 0xff) {
+        auto const marker = data[pos + 1];
+        if (marker == 0xda) {
+            break; // Start of scan: no more metadata.
+        }
+        std::size_t const length = (data[pos + 2] << 8) | data[pos + 3];
+        if (marker == 0xe1 && pos + 8 <= data.size() && std::memcmp(&data[pos + 4], "Exif", 4) == 0) {
+            return false;
+        }
+        pos += 2 + length;
+    }
+    return true;
+}
+
+/**
+ * Whether colours in an ICC profile look the same as in sRGB, so that JPEG data using it can be
+ * kept without the profile. Compares a grid of colours covering the primaries and tone curves.
+ */
+static bool profile_is_srgb(cmsHPROFILE profile)
+{
+    auto const space = cmsGetColorSpace(profile);
+    if (space != cmsSigRgbData && space != cmsSigGrayData) {
+        return false;
+    }
+    bool const gray = space == cmsSigGrayData;
+
+    auto srgb = cmsCreate_sRGBProfile();
+    auto transform = cmsCreateTransform(profile, gray ? TYPE_GRAY_8 : TYPE_RGB_8, srgb, TYPE_RGB_8,
+                                        INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOCACHE);
+    cmsCloseProfile(srgb);
+    if (!transform) {
+        return false;
+    }
+
+    std::vector<guchar> input, expected;
+    for (int r = 0; r <= 255; r += 17) {
+        if (gray) {
+            input.push_back(r);
+            expected.insert(expected.end(), 3, r);
+            continue;
+        }
+        for (int g = 0; g <= 255; g += 51) {
+            for (int b = 0; b <= 255; b += 51) {
+                input.insert(input.end(), {(guchar)r, (guchar)g, (guchar)b});
+            }
+        }
+    }
+    if (!gray) {
+        expected = input;
+    }
+    std::vector<guchar> output(expected.size());
+    cmsDoTransform(transform, input.data(), output.data(), expected.size() / 3);
+    cmsDeleteTransform(transform);
+
+    return std::equal(output.begin(), output.end(), expected.begin(), [] (int a, int b) {
+        return std::abs(a - b) <= 2;
+    });
+}
+
+/**
+ * Whether the DCTDecode parameters of an image stream ask for a colour transform. Its default
+ * depends on the JPEG data, which is what viewers of the JPEG also go by, so only streams that
+ * set it explicitly are affected.
+ */
+static bool sets_color_transform(Stream *str)
+{
+    auto const dict = str->getDict();
+    if (!dict) {
+        return false;
+    }
+    auto params = dict->lookup("DecodeParms");
+    if (params.isNull()) {
+        params = dict->lookup("DP");
+    }
+    // With several filters, the DCT one is applied last, so its parameters come last.
+    if (params.isArray() && params.arrayGetLength() > 0) {
+        params = params.arrayGet(params.arrayGetLength() - 1);
+    }
+    return params.isDict() && !params.dictLookup("ColorTransform").isNull();
+}
+
+/**
+ * Return the JPEG data of an image stream if it can be kept as it is, or nothing if the image has
+ * to be decoded. That takes a DCT stream in grey or RGB, or with an ICC profile equivalent to
+ * sRGB, with the default decode ranges and colour transform.
+ */
+static std::vector<guchar> get_jpeg_data(Stream *str, GfxImageColorMap *color_map)
+{
+    if (str->getKind() != strDCT || !color_map) {
+        return {};
+    }
+
+    auto const space = color_map->getColorSpace();
+    auto const mode = space->getMode();
+    if (mode == csICCBased) {
+#if POPPLER_CHECK_VERSION(0, 90, 0)
+        auto const profile = static_cast<GfxICCBasedColorSpace *>(space)->getProfile();
+        if (!profile || !profile_is_srgb(profile.get())) {
+            return {};
+        }
+#else
+        return {};
+#endif
+    } else if (mode != csDeviceGray && mode != csDeviceRGB) {
+        return {};
+    }
+    for (int i = 0; i < color_map->getNumPixelComps(); i++) {
+        if (color_map->getDecodeLow(i) != 0.0 || color_map->getDecodeHigh(i) != 1.0) {
+            return {};
+        }
+    }
+    if (sets_color_transform(str)) {
+        return {};
+    }
+
+    auto const raw = str->getNextStream();
+    if (!raw) {
+        return {};
+    }
+    constexpr int block_size = 65536;
+    std::vector<guchar> data;
+    raw->reset();
+    while (true) {
+        auto const size = data.size();
+        data.resize(size + block_size);
+        int const read = raw->doGetChars(block_size, data.data() + size);
+        data.resize(size + std::max(read, 0));
+        if (read < block_size) {
+            break;
+        }
+    }
+    raw->close();
+
+    if (!jpeg_is_usable(data)) {
+        return {};
+    }
+    return data;
+}
+
+/**
+ * Decode the pixels of an image stream: one byte of alpha per pixel if alpha_only, and native
+ * endian ARGB words otherwise.
+ */
+static std::vector<guchar> read_pixels(Stream *str, int width, int height, GfxImageColorMap *color_map,
+                                       int *mask_colors, bool alpha_only, bool invert_alpha)
+{
+    std::vector<guchar> pixels;
     ImageStream *image_stream;
     if (alpha_only) {
+        pixels.resize(std::size_t(width) * height);
         if (color_map) {
             image_stream = new ImageStream(str, width, color_map->getNumPixelComps(),
                                            color_map->getBits());
@@ -1890,10 +2047,10 @@ Inkscape::XML::Node *SvgBuilder::_createImage(Stream *str, int width, int height
         image_stream->reset();
 
         // Convert grayscale values
-        unsigned char *buffer = new unsigned char[width];
         int invert_bit = invert_alpha ? 1 : 0;
         for ( int y = 0 ; y < height ; y++ ) {
             unsigned char *row = image_stream->getLine();
+            unsigned char *buffer = pixels.data() + std::size_t(y) * width;
             if (color_map) {
                 color_map->getGrayLine(row, buffer, width);
             } else {
@@ -1906,20 +2063,19 @@ Inkscape::XML::Node *SvgBuilder::_createImage(Stream *str, int width, int height
                     }
                 }
             }
-            png_write_row(png_ptr, (png_bytep)buffer);
         }
-        delete [] buffer;
-    } else if (color_map) {
+    } else {
+        pixels.resize(std::size_t(width) * height * sizeof(unsigned int));
         image_stream = new ImageStream(str, width,
                                        color_map->getNumPixelComps(),
                                        color_map->getBits());
         image_stream->reset();
 
         // Convert RGB values
-        unsigned int *buffer = new unsigned int[width];
-        if (mask_colors) {
-            for ( int y = 0 ; y < height ; y++ ) {
-                unsigned char *row = image_stream->getLine();
+        for ( int y = 0 ; y < height ; y++ ) {
+            unsigned char *row = image_stream->getLine();
+            auto buffer = reinterpret_cast<unsigned int *>(pixels.data()) + std::size_t(y) * width;
+            if (mask_colors) {
                 color_map->getRGBLine(row, buffer, width);
 
                 unsigned int *dest = buffer;
@@ -1936,32 +2092,83 @@ Inkscape::XML::Node *SvgBuilder::_createImage(Stream *str, int width, int height
                     row += color_map->getNumPixelComps();
                     dest++;
                 }
-                // Write it to the PNG
-                png_write_row(png_ptr, (png_bytep)buffer);
-            }
-        } else {
-            for ( int i = 0 ; i < height ; i++ ) {
-                unsigned char *row = image_stream->getLine();
+            } else {
                 memset((void*)buffer, 0xff, sizeof(int) * width);
                 color_map->getRGBLine(row, buffer, width);
-                png_write_row(png_ptr, (png_bytep)buffer);
             }
         }
-        delete [] buffer;
-
-    } else {    // A colormap must be provided, so quit
-        png_destroy_write_struct(&png_ptr, &info_ptr);
-        if (!embed_image) {
-            fclose(fp);
-            g_free(file_name);
-        }
-        return nullptr;
     }
     delete image_stream;
     str->close();
-    // Close PNG
-    png_write_end(png_ptr, info_ptr);
-    png_destroy_write_struct(&png_ptr, &info_ptr);
+
+    return pixels;
+}
+
+/// Return a new name for an image file written next to the imported document.
+static std::string image_file_name(gchar const *docname, char const *extension)
+{
+    static int counter = 0;
+    gchar *name = g_strdup_printf("%s_img%d.%s", docname, counter++, extension);
+    std::string result = name;
+    g_free(name);
+    return result;
+}
+
+/**
+ * Turn encoded image data into an href: a data URI, or if a file name is given, the name of the
+ * file it is written to. Only uses its arguments, so it can run on any thread.
+ */
+static std::string image_href(std::vector<guchar> const &data, char const *mime_type, std::string const &file_name)
+{
+    if (data.empty()) {
+        return {};
+    }
+    if (file_name.empty()) {
+        // Append format specification to the URI
+        auto *base64String = g_base64_encode(data.data(), data.size());
+        auto uri = std::string("data:") + mime_type + ";base64," + base64String;
+        g_free(base64String);
+        return uri;
+    }
+    if (!g_file_set_contents(file_name.c_str(), reinterpret_cast<gchar const *>(data.data()), data.size(), nullptr)) {
+        return {};
+    }
+    return file_name;
+}
+
+/**
+ * \brief Creates an <image> element containing the given ImageStream as a PNG or JPEG
+ *
+ * JPEG streams are kept in their original encoding where possible, instead of being decoded and
+ * compressed again. Otherwise, the pixels are read from the stream here, but compressed on another
+ * thread while parsing goes on. The image gets its href once that is done, at the latest in
+ * finishImages().
+ */
+Inkscape::XML::Node *SvgBuilder::_createImage(Stream *str, int width, int height,
+                                              GfxImageColorMap *color_map, bool interpolate,
+                                              int *mask_colors, bool alpha_only,
+                                              bool invert_alpha) {
+
+    // A colormap must be provided, unless only the alpha is wanted
+    if (!alpha_only && !color_map) {
+        return nullptr;
+    }
+
+    // Decide whether we should embed this image
+    bool embed_image = _preferences->getAttributeBoolean("embedImages", true);
+
+    std::function<std::string()> make_href;
+    auto jpeg = alpha_only || mask_colors ? std::vector<guchar>() : get_jpeg_data(str, color_map);
+    if (!jpeg.empty()) {
+        auto file_name = embed_image ? std::string() : image_file_name(_docname, "jpg");
+        make_href = [jpeg = std::move(jpeg), file_name] { return image_href(jpeg, "image/jpeg", file_name); };
+    } else {
+        auto pixels = read_pixels(str, width, height, color_map, mask_colors, alpha_only, invert_alpha);
+        auto file_name = embed_image ? std::string() : image_file_name(_docname, "png");
+        make_href = [=, pixels = std::move(pixels)] {
+            return image_href(encode_png(pixels, width, height, alpha_only, invert_alpha), "image/png", file_name);
+        };
+    }
 
     // Create repr
     Inkscape::XML::Node *image_node = _xml_doc->createElement("svg:image");
@@ -1979,21 +2186,40 @@ Inkscape::XML::Node *SvgBuilder::_createImage(Stream *str, int width, int height
     image_node->setAttribute("preserveAspectRatio", "none");
 
     // Create href
-    if (embed_image) {
-        // Append format specification to the URI
-        auto *base64String = g_base64_encode(png_buffer.data(), png_buffer.size());
-        auto png_data = std::string("data:image/png;base64,") + base64String;
-        g_free(base64String);
-        image_node->setAttributeOrRemoveIfEmpty("xlink:href", png_data);
-    } else {
-        fclose(fp);
-        image_node->setAttribute("xlink:href", file_name);
-        g_free(file_name);
-    }
+    _queueImage(image_node, std::move(make_href));
 
     return image_node;
 }
 
+void SvgBuilder::_queueImage(Inkscape::XML::Node *node, std::function<std::string()> make_href)
+{
+    auto &pending = *_pending_images;
+
+    // Bound the memory held by pixels waiting to be compressed.
+    static unsigned const max_pending = 2 * std::max(std::thread::hardware_concurrency(), 1u);
+    while (pending.size() >= max_pending) {
+        _finishImage(pending.front());
+        pending.pop_front();
+    }
+
+    Inkscape::GC::anchor(node);
+    pending.push_back({node, std::async(std::launch::async, std::move(make_href))});
+}
+
+void SvgBuilder::_finishImage(PendingImage &image)
+{
+    image.node->setAttributeOrRemoveIfEmpty("xlink:href", image.href.get());
+    Inkscape::GC::release(image.node);
+}
+
+void SvgBuilder::finishImages()
+{
+    for (auto &image : *_pending_images) {
+        _finishImage(image);
+    }
+    _pending_images->clear();
+}
+
 /**
  * \brief Creates a <mask> with the specified width and height and adds to <defs>
  *  If we're not the top-level SvgBuilder, creates a <defs> too and adds the mask to it.
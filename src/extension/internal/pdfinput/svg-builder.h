@@ -58,6 +58,9 @@ class CairoFont;
 class SPCSSAttr;
 class ClipHistoryEntry;
 
+#include <deque>
+#include <functional>
+#include <future>
 #include <glib.h>
 #include <map>
 #include <memory>
@@ -109,6 +112,9 @@ public:
     }
     void pushPage(const std::string &label, GfxState *state);
 
+    // Give all images their href, once the threads compressing them are done
+    void finishImages();
+
     // Path adding
     bool shouldMergePath(bool is_fill, const std::string &path);
     bool mergePath(GfxState *state, bool is_fill, const std::string &path, bool even_odd = false);
@@ -189,6 +195,13 @@ private:
                                       GfxImageColorMap *color_map, bool interpolate,
                                       int *mask_colors, bool alpha_only=false,
                                       bool invert_alpha=false);
+    struct PendingImage
+    {
+        Inkscape::XML::Node *node;
+        std::future<std::string> href;
+    };
+    void _queueImage(Inkscape::XML::Node *node, std::function<std::string()> make_href);
+    void _finishImage(PendingImage &image);
     Inkscape::XML::Node *_createMask(double width, double height);
     Inkscape::XML::Node *_createClip(const std::string &d, const Geom::Affine tr, bool even_odd);
 
@@ -271,6 +284,8 @@ private:
     std::string _icc_profile;
     std::map<cmsHPROFILE, std::string> _icc_profiles;
 
+    std::shared_ptr<std::deque<PendingImage>> _pending_images; // shared with child builders
+
     ClipHistoryEntry *_clip_history; // clip path stack
     Inkscape::XML::Node *_clip_text = nullptr;
     Inkscape::XML::Node *_clip_text_group = nullptr;
@@ -12,6 +12,8 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <vector>
 #include <2geom/transforms.h>
 #include <gdk/gdk.h>
 
@@ -26,7 +28,58 @@
 #include "object/sp-use.h"
 #include "util/units.h"
 #include "util/scope_exit.h"
+#include "util/worker-pool.h"
 #include "inkscape.h"
+#include "preferences.h"
+
+namespace {
+
+/**
+ * Render the drawing into the image surface in horizontal bands, each on its own thread.
+ *
+ * The drawing must already be up to date, and stay unchanged until this returns. Each band gets
+ * an image surface of its own onto the rows it covers, so that no Cairo object is shared.
+ */
+void render_in_bands(Inkscape::Drawing const &drawing, cairo_surface_t *surface, Geom::IntRect const &area, unsigned flags)
+{
+    // Below this many pixels per band, starting threads costs more than it saves. Filters also
+    // have to render a margin around each band, which becomes relatively expensive for thin bands.
+    constexpr int min_band_pixels = 256 * 256;
+
+    int const width = area.width();
+    int const height = area.height();
+    int num_bands = Inkscape::Preferences::get()->getIntLimited("/options/threading/numthreads", Inkscape::Util::default_numthreads(), 1, 256);
+    num_bands = std::min(num_bands, int(std::size_t(width) * height / min_band_pixels));
+
+    if (num_bands < 2) {
+        Inkscape::DrawingContext dc(surface, area.min());
+        drawing.render(dc, area, flags);
+        return;
+    }
+
+    cairo_surface_flush(surface);
+    auto const data = cairo_image_surface_get_data(surface);
+    auto const stride = cairo_image_surface_get_stride(surface);
+
+    // Bands run in the shared worker pool, so filters within them split their work among the
+    // workers left idle instead of starting more threads.
+    Inkscape::Util::WorkerPool::get()->dispatch(num_bands, num_bands, [&] (int i, int) {
+        int const y0 = height * i / num_bands;
+        int const y1 = height * (i + 1) / num_bands;
+        auto band = cairo_image_surface_create_for_data(data + std::size_t(y0) * stride, CAIRO_FORMAT_ARGB32, width, y1 - y0, stride);
+        {
+            auto const band_area = Geom::IntRect(area.left(), area.top() + y0, area.right(), area.top() + y1);
+            Inkscape::DrawingContext dc(band, band_area.min());
+            drawing.render(dc, band_area, flags);
+        }
+        cairo_surface_flush(band);
+        cairo_surface_destroy(band);
+    });
+
+    cairo_surface_mark_dirty(surface);
+}
+
+} // namespace
 
 /**
     Generates a bitmap from given items. The bitmap is stored in RAM and not written to file.
@@ -96,21 +149,18 @@ Inkscape::Pixbuf *sp_generate_internal_bitmap(SPDocument *document,
         return nullptr;
     }
 
-    Inkscape::DrawingContext dc(surface, Geom::Point(0, 0));
-
     if (checkerboard_color) {
+        Inkscape::DrawingContext dc(surface, Geom::Point(0, 0));
         auto pattern = ink_cairo_pattern_create_checkerboard(*checkerboard_color);
-        dc.save();
         dc.transform(Geom::Scale(device_scale));
         dc.setOperator(CAIRO_OPERATOR_SOURCE);
         dc.setSource(pattern);
         dc.paint();
-        dc.restore();
         cairo_pattern_destroy(pattern);
     }
 
     // render items
-    drawing.render(dc, final_area, Inkscape::DrawingItem::RENDER_BYPASS_CACHE);
+    render_in_bands(drawing, surface, final_area, Inkscape::DrawingItem::RENDER_BYPASS_CACHE);
 
     if (device_scale != 1.0) {
         cairo_surface_set_device_scale(surface, device_scale, device_scale);
@@ -409,9 +409,9 @@ void GzipOutputStream::flush()
 
     totalOut += destlen;
     //skip the redundant zlib header and checksum
-    for (uLong i=2; i<destlen-4 ; i++)
+    if (destlen > 6)
         {
-        destination.put((int)destbuf[i]);
+        destination.write(reinterpret_cast<char const *>(destbuf) + 2, destlen - 6);
         }
         
     destination.flush();
@@ -441,6 +441,19 @@ int GzipOutputStream::put(char ch)
     return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream.
+ */
+int GzipOutputStream::write(char const *data, std::size_t size)
+{
+    if (closed)
+        return -1;
+
+    inputBuf.insert(inputBuf.end(), data, data + size);
+    totalIn += size;
+    return size;
+}
+
 
 
 } // namespace IO
@@ -13,6 +13,7 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 #include "inkscapestream.h"
 
 namespace Inkscape
@@ -87,6 +88,25 @@ int BasicInputStream::get()
    
 
 
+//#########################################################################
+//# O U T P U T    S T R E A M
+//#########################################################################
+
+/**
+ * Writes the specified bytes to this output stream, one at a time.
+ */
+int OutputStream::write(char const *data, std::size_t size)
+{
+    for (std::size_t i = 0; i < size; i++) {
+        if (put(data[i]) < 0) {
+            return -1;
+        }
+    }
+    return size;
+}
+
+
+
 //#########################################################################
 //# B A S I C    O U T P U T    S T R E A M
 //#########################################################################
@@ -469,6 +489,17 @@ void BasicWriter::put(char ch)
         destination->put(ch);
 }
 
+/**
+ * Writes the specified bytes to this output writer.
+ */
+Writer &BasicWriter::write(char const *str, std::size_t len)
+{
+    for (std::size_t i = 0; i < len; i++) {
+        put(str[i]);
+    }
+    return *this;
+}
+
 /**
  * Provide printf()-like formatting
  */ 
@@ -508,9 +539,7 @@ Writer &BasicWriter::writeUString(const Glib::ustring &str)
  */ 
 Writer &BasicWriter::writeStdString(const std::string &str)
 {
-    for (char it : str) {
-        put(it);
-    }
+    write(str.data(), str.size());
     return *this;
 }
 
@@ -519,12 +548,9 @@ Writer &BasicWriter::writeStdString(const std::string &str)
  */ 
 Writer &BasicWriter::writeString(const char *str)
 {
-    std::string tmp;
-    if (str)
-        tmp = str;
-    else
-        tmp = "null";
-    writeStdString(tmp);
+    if (!str)
+        str = "null";
+    write(str, std::strlen(str));
     return *this;
 }
 
@@ -740,6 +766,15 @@ void OutputStreamWriter::put(char ch)
     outputStream.put(ch);
 }
 
+/**
+ *  Overloaded to pass blocks of chars on to the OutputStream at once.
+ */
+Writer &OutputStreamWriter::write(char const *str, std::size_t len)
+{
+    outputStream.write(str, len);
+    return *this;
+}
+
 //#########################################################################
 //# S T D    W R I T E R
 //#########################################################################
@@ -10,6 +10,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cstddef>
 #include <cstdio>
 #include <glibmm/ustring.h>
 
@@ -194,6 +195,12 @@ public:
      */
     virtual int put(char ch) = 0;
 
+    /**
+     * Send a block of bytes to the destination stream. Streams that can take them at once
+     * should override this; the default sends them one by one through put().
+     */
+    virtual int write(char const *data, std::size_t size);
+
 
 }; // class OutputStream
 
@@ -474,6 +481,8 @@ public:
     virtual void flush() = 0;
     
     virtual void put(char ch) = 0;
+
+    virtual Writer& write(char const *str, std::size_t len) = 0;
     
     /* Formatted output */
     virtual Writer& printf(char const *fmt, ...) G_GNUC_PRINTF(2,3) = 0;
@@ -528,6 +537,8 @@ public:
     void flush() override;
     
     void put(char ch) override;
+
+    Writer& write(char const *str, std::size_t len) override;
     
     
     
@@ -620,6 +631,8 @@ public:
     
     void put(char ch) override;
 
+    Writer& write(char const *str, std::size_t len) override;
+
 
 private:
 
@@ -10,18 +10,26 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <atomic>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
 
 #include "Layout-TNG.h"
+#include "preferences.h"
 #include "style.h"
 #include "font-instance.h"
 #include "font-factory.h"
+#include "shaping-cache.h"
 #include "svg/svg-length.h"
 #include "object/sp-object.h"
 #include "object/sp-flowdiv.h"
 #include "Layout-TNG-Scanline-Maker.h"
 #include <limits>
 #include "livarot/Shape.h"
+#include "util/worker-pool.h"
 
 namespace Inkscape {
 namespace Text {
@@ -248,6 +256,24 @@ class Layout::Calculator
     bool _goToNextWrapShape();
     void _createFirstScanlineMaker();
 
+    /* Incremental reflow, see Layout::markParagraphDirty(). After a paragraph has been
+       copied from the previous output the scanline maker is only moved to where that
+       paragraph ended once another paragraph actually needs flowing. */
+    bool _scanline_resume_pending = false;
+    double _scanline_resume_y = 0.0;
+
+    std::string _flowFingerprint() const;
+    unsigned _findParagraphEnd(unsigned first_input_index) const;
+    std::string _paragraphFingerprint(unsigned first_input_index, unsigned end_input_index) const;
+    std::string _entryState(bool keep_going) const;
+    ParagraphCheckpoint::OutputSizes _outputSizes() const;
+    ParagraphCheckpoint const *_findReusableParagraph(PreviousOutput const &previous,
+                                                      ParagraphCheckpoint const &checkpoint) const;
+    void _reuseParagraph(PreviousOutput const &previous, ParagraphCheckpoint const &old,
+                         unsigned first_input_index, bool *keep_going);
+    void _recordSpanTextRefs();
+    void _resumeScanlineMaker();
+
     bool _findChunksForLine(ParagraphInfo const &para,
                             UnbrokenSpanPosition *start_span_pos,
                             std::vector<ChunkInfo> *chunk_info,
@@ -1609,13 +1635,13 @@ unsigned Layout::Calculator::_buildSpansForPara(ParagraphInfo *para) const
                     auto gnew = std::string_view(para->text.data()         + para_text_index,           new_span.text_bytes);
                     assert (gold == gnew);
 
-                    // Convert characters to glyphs
-                    pango_shape_full(para->text.data() + para_text_index,
-                                     new_span.text_bytes,
-                                     para->text.data(),
-                                     -1,
-                                     &para->pango_items[pango_item_index].item->analysis,
-                                     new_span.glyph_string);
+                    // Convert characters to glyphs (identical runs are shaped only once per process)
+                    ShapingCache::get().shape(para->text.data(),
+                                              para->text.bytes(),
+                                              para_text_index,
+                                              new_span.text_bytes,
+                                              &para->pango_items[pango_item_index].item->analysis,
+                                              new_span.glyph_string);
 
                     if (para->pango_items[pango_item_index].item->analysis.level & 1) {
                         // Right to left text (Arabic, Hebrew, etc.)
@@ -2099,6 +2125,322 @@ void Layout::Calculator::dumpUnbrokenSpans(ParagraphInfo *para){
 }
 #endif //DEBUG_LAYOUT_TNG_COMPUTE
 
+// ******************* incremental reflow
+
+template <typename T>
+static void fingerprint_add(std::string &fingerprint, T const &value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    fingerprint.append(reinterpret_cast<char const *>(&value), sizeof(value));
+}
+
+static void fingerprint_add_string(std::string &fingerprint, std::string_view value)
+{
+    fingerprint_add(fingerprint, value.size());
+    fingerprint.append(value);
+}
+
+static void fingerprint_add_lengths(std::string &fingerprint, std::vector<SVGLength> const &lengths)
+{
+    fingerprint_add(fingerprint, lengths.size());
+    for (auto const &length : lengths) {
+        fingerprint_add(fingerprint, length._set);
+        fingerprint_add(fingerprint, length.unit);
+        fingerprint_add(fingerprint, length.value);
+        fingerprint_add(fingerprint, length.computed);
+    }
+}
+
+static void fingerprint_add_metrics(std::string &fingerprint, Layout::FontMetrics const &metrics)
+{
+    fingerprint_add(fingerprint, metrics.ascent);
+    fingerprint_add(fingerprint, metrics.descent);
+    fingerprint_add(fingerprint, metrics.xheight);
+    fingerprint_add(fingerprint, metrics.ascent_max);
+    fingerprint_add(fingerprint, metrics.descent_max);
+}
+
+/// Everything in a style that the calculator reads.
+static void fingerprint_add_style(std::string &fingerprint, SPStyle *style)
+{
+    PangoFontDescription *descr = ink_font_description_from_style(style);
+    char *descr_string = pango_font_description_to_string(descr);
+    fingerprint_add_string(fingerprint, descr_string);
+    g_free(descr_string);
+    pango_font_description_free(descr);
+
+    fingerprint_add_string(fingerprint, style->getFontFeatureString());
+    fingerprint_add(fingerprint, style->font_size.computed);
+    fingerprint_add(fingerprint, style->line_height.normal);
+    fingerprint_add(fingerprint, style->line_height.unit);
+    fingerprint_add(fingerprint, style->line_height.computed);
+    fingerprint_add(fingerprint, style->letter_spacing.normal);
+    fingerprint_add(fingerprint, style->letter_spacing.computed);
+    fingerprint_add(fingerprint, style->word_spacing.normal);
+    fingerprint_add(fingerprint, style->word_spacing.computed);
+    fingerprint_add(fingerprint, style->baseline_shift.computed);
+    fingerprint_add(fingerprint, style->direction.computed);
+    fingerprint_add(fingerprint, style->dominant_baseline.computed);
+    fingerprint_add(fingerprint, style->text_orientation.computed);
+    fingerprint_add(fingerprint, style->writing_mode.computed);
+}
+
+/** Settings of the whole flow which, if changed, invalidate every paragraph. */
+std::string Layout::Calculator::_flowFingerprint() const
+{
+    std::string fingerprint;
+    fingerprint_add(fingerprint, _block_progression);
+    fingerprint_add(fingerprint, _flow._blockTextOrientation());
+    fingerprint_add(fingerprint, _flow.wrap_mode);
+    fingerprint_add_metrics(fingerprint, _flow.strut);
+
+    // The infinite scanline maker takes its x from the very first text source.
+    auto first_source = static_cast<InputStreamTextSource const *>(_flow._input_stream.front());
+    fingerprint_add(fingerprint, first_source->x.empty() ? 0.0f : first_source->x.front().computed);
+    fingerprint_add(fingerprint, first_source->y.empty() ? 0.0f : first_source->y.front().computed);
+
+    fingerprint_add(fingerprint, _flow._input_wrap_shapes.size());
+    for (auto const &wrap_shape : _flow._input_wrap_shapes) {
+        fingerprint_add(fingerprint, wrap_shape.display_align);
+        Shape const *shape = wrap_shape.shape;
+        fingerprint_add(fingerprint, shape->numberOfPoints());
+        for (int i = 0; i < shape->numberOfPoints(); i++) {
+            fingerprint_add(fingerprint, shape->getPoint(i).x[Geom::X]);
+            fingerprint_add(fingerprint, shape->getPoint(i).x[Geom::Y]);
+        }
+        fingerprint_add(fingerprint, shape->numberOfEdges());
+        for (int i = 0; i < shape->numberOfEdges(); i++) {
+            fingerprint_add(fingerprint, shape->getEdge(i).st);
+            fingerprint_add(fingerprint, shape->getEdge(i).en);
+        }
+    }
+    return fingerprint;
+}
+
+/** Returns the index of the control code that ends the paragraph starting at
+\a first_input_index, or the size of the input stream. */
+unsigned Layout::Calculator::_findParagraphEnd(unsigned first_input_index) const
+{
+    unsigned input_index = first_input_index;
+    for ( ; input_index < _flow._input_stream.size() ; input_index++) {
+        if (_flow._input_stream[input_index]->Type() == CONTROL_CODE) {
+            auto control_code = static_cast<InputStreamControlCode const *>(_flow._input_stream[input_index]);
+            if (control_code->code == SHAPE_BREAK || control_code->code == PARAGRAPH_BREAK) {
+                break;
+            }
+        }
+    }
+    return input_index;
+}
+
+/** Serialises everything in the input stream that the output of one paragraph depends on. */
+std::string Layout::Calculator::_paragraphFingerprint(unsigned first_input_index, unsigned end_input_index) const
+{
+    std::string fingerprint;
+    bool const try_text_align = !_flow._input_wrap_shapes.empty();
+
+    // Position in the stream matters for the first line and the end-of-paragraph handling.
+    fingerprint_add(fingerprint, first_input_index == 0);
+    fingerprint_add(fingerprint, end_input_index + 1 < _flow._input_stream.size());
+    fingerprint_add(fingerprint, end_input_index == _flow._input_stream.size());
+
+    unsigned const last = std::min<unsigned>(end_input_index + 1, _flow._input_stream.size());
+    for (unsigned input_index = first_input_index ; input_index < last ; input_index++) {
+        auto item = _flow._input_stream[input_index];
+        fingerprint_add(fingerprint, item->Type());
+        if (item->Type() == TEXT_SOURCE) {
+            auto text_source = static_cast<InputStreamTextSource const *>(item);
+            fingerprint_add_string(fingerprint, std::string_view(&*text_source->text_begin.base(),
+                                                                 text_source->text_end.base() - text_source->text_begin.base()));
+            fingerprint_add_style(fingerprint, text_source->style);
+            fingerprint_add(fingerprint, text_source->styleGetAlignment(LEFT_TO_RIGHT, try_text_align));
+            fingerprint_add(fingerprint, text_source->styleGetAlignment(RIGHT_TO_LEFT, try_text_align));
+            fingerprint_add_lengths(fingerprint, text_source->x);
+            fingerprint_add_lengths(fingerprint, text_source->y);
+            fingerprint_add_lengths(fingerprint, text_source->dx);
+            fingerprint_add_lengths(fingerprint, text_source->dy);
+            fingerprint_add_lengths(fingerprint, text_source->rotate);
+            fingerprint_add_string(fingerprint, text_source->source ? text_source->source->lang.raw() : std::string());
+        } else {
+            auto control_code = static_cast<InputStreamControlCode const *>(item);
+            fingerprint_add(fingerprint, control_code->code);
+            fingerprint_add(fingerprint, control_code->ascent);
+            fingerprint_add(fingerprint, control_code->descent);
+            fingerprint_add(fingerprint, control_code->width);
+            // Empty lines take their height from the style of the break (see _buildSpansForPara()).
+            SPObject const *object = control_code->source;
+            if (object && is<SPFlowpara>(object)) {
+                object = object->parent;
+            }
+            fingerprint_add(fingerprint, object && object->style);
+            if (object && object->style) {
+                fingerprint_add_style(fingerprint, object->style);
+            }
+        }
+    }
+    return fingerprint;
+}
+
+/** Serialises the flow position at the start of a paragraph, and the span
+that an empty paragraph would copy its metrics from. */
+std::string Layout::Calculator::_entryState(bool keep_going) const
+{
+    std::string state;
+    fingerprint_add(state, _current_shape_index);
+    fingerprint_add(state, _scanline_resume_pending ? _scanline_resume_y : _scanline_maker->yCoordinate());
+    fingerprint_add(state, _y_offset);
+    fingerprint_add(state, keep_going);
+    fingerprint_add(state, _flow._spans.empty());
+    if (!_flow._spans.empty()) {
+        Layout::Span const &span = _flow._spans.back();
+        fingerprint_add(state, span.font.get());
+        fingerprint_add(state, span.font_size);
+        fingerprint_add(state, span.x_end);
+        fingerprint_add_metrics(state, span.line_height);
+    }
+    return state;
+}
+
+Layout::ParagraphCheckpoint::OutputSizes Layout::Calculator::_outputSizes() const
+{
+    return {(unsigned)_flow._paragraphs.size(), (unsigned)_flow._lines.size(), (unsigned)_flow._chunks.size(),
+            (unsigned)_flow._spans.size(), (unsigned)_flow._characters.size(), (unsigned)_flow._glyphs.size()};
+}
+
+/** Looks for a paragraph of the previous output that was calculated from the
+same input and the same starting position as the one described by \a checkpoint.
+Paragraphs before the edited one are looked for at the same input index, those
+after it at the same distance from the end of the input stream. */
+Layout::ParagraphCheckpoint const *
+Layout::Calculator::_findReusableParagraph(PreviousOutput const &previous, ParagraphCheckpoint const &checkpoint) const
+{
+    auto find = [&] (long first_input_index) -> ParagraphCheckpoint const * {
+        auto it = std::lower_bound(previous.checkpoints.begin(), previous.checkpoints.end(), first_input_index,
+                                   [] (ParagraphCheckpoint const &c, long index) { return c.first_input_index < index; });
+        if (it == previous.checkpoints.end() || it->first_input_index != first_input_index) {
+            return nullptr;
+        }
+        if (it->input != checkpoint.input || it->entry_state != checkpoint.entry_state) {
+            return nullptr;
+        }
+        return &*it;
+    };
+
+    if (_flow._paragraphs.size() < _flow._first_dirty_paragraph) {
+        if (auto old = find(checkpoint.first_input_index)) {
+            return old;
+        }
+    }
+    long const delta = (long)_flow._input_stream.size() - (long)previous.input_size;
+    if (delta != 0 || _flow._paragraphs.size() >= _flow._first_dirty_paragraph) {
+        return find((long)checkpoint.first_input_index - delta);
+    }
+    return nullptr;
+}
+
+/** Appends the output of paragraph \a old from the previous layout, renumbering
+the links between output arrays, and leaves the calculator where that paragraph ended. */
+void Layout::Calculator::_reuseParagraph(PreviousOutput const &previous, ParagraphCheckpoint const &old,
+                                         unsigned first_input_index, bool *keep_going)
+{
+    auto const now = _outputSizes();
+    unsigned const delta_paragraph = now.paragraphs - old.start.paragraphs;
+    unsigned const delta_line = now.lines - old.start.lines;
+    unsigned const delta_chunk = now.chunks - old.start.chunks;
+    unsigned const delta_span = now.spans - old.start.spans;
+    unsigned const delta_character = now.characters - old.start.characters;
+    unsigned const delta_glyph = now.glyphs - old.start.glyphs;
+    unsigned const delta_input = first_input_index - old.first_input_index;
+
+    _flow._paragraphs.insert(_flow._paragraphs.end(), previous.paragraphs.begin() + old.start.paragraphs,
+                             previous.paragraphs.begin() + old.end.paragraphs);
+
+    for (unsigned i = old.start.lines ; i < old.end.lines ; i++) {
+        Line line = previous.lines[i];
+        line.in_paragraph += delta_paragraph;
+        _flow._lines.push_back(line);
+    }
+    for (unsigned i = old.start.chunks ; i < old.end.chunks ; i++) {
+        Chunk chunk = previous.chunks[i];
+        chunk.in_line += delta_line;
+        _flow._chunks.push_back(chunk);
+    }
+    for (unsigned i = old.start.spans ; i < old.end.spans ; i++) {
+        Span span = previous.spans[i];
+        span.in_chunk += delta_chunk;
+        span.in_input_stream_item += delta_input;
+        SpanTextRef ref = previous.span_text_refs[i];
+        if (ref.input_index != SpanTextRef::NONE) {
+            ref.input_index += delta_input;
+            auto text_source = static_cast<InputStreamTextSource const *>(_flow._input_stream[ref.input_index]);
+            span.input_stream_first_character = Glib::ustring::const_iterator(text_source->text->raw().begin() + ref.offset);
+        } else {
+            span.input_stream_first_character = Glib::ustring::const_iterator();
+        }
+        _flow._spans.push_back(span);
+        _flow._span_text_refs.push_back(ref);
+    }
+    for (unsigned i = old.start.characters ; i < old.end.characters ; i++) {
+        Character character = previous.characters[i];
+        character.in_span += delta_span;
+        if (character.in_glyph != -1) {
+            character.in_glyph += delta_glyph;
+        }
+        _flow._characters.push_back(character);
+    }
+    for (unsigned i = old.start.glyphs ; i < old.end.glyphs ; i++) {
+        Glyph glyph = previous.glyphs[i];
+        glyph.in_character += delta_character;
+        _flow._glyphs.push_back(glyph);
+    }
+
+    if (old.exit_shape_index != _current_shape_index) {
+        _current_shape_index = old.exit_shape_index;
+        delete _scanline_maker;
+        _scanline_maker = nullptr;
+    }
+    _scanline_resume_pending = true;
+    _scanline_resume_y = old.exit_scanline_y;
+    _y_offset = old.exit_y_offset;
+    *keep_going = old.exit_keep_going;
+}
+
+/** Remembers where the spans added since the last call point into the input text. */
+void Layout::Calculator::_recordSpanTextRefs()
+{
+    for (unsigned i = _flow._span_text_refs.size() ; i < _flow._spans.size() ; i++) {
+        Span const &span = _flow._spans[i];
+        SpanTextRef ref;
+        auto item = _flow._input_stream[span.in_input_stream_item];
+        if (item->Type() == TEXT_SOURCE) {
+            auto text_source = static_cast<InputStreamTextSource const *>(item);
+            ref.input_index = span.in_input_stream_item;
+            ref.offset = span.input_stream_first_character.base() - text_source->text->raw().begin();
+        } else if (i > 0) {
+            // Spans for breaks are copies of the span before them.
+            ref = _flow._span_text_refs[i - 1];
+        }
+        _flow._span_text_refs.push_back(ref);
+    }
+}
+
+/** Moves the scanline maker to where the last copied paragraph ended. */
+void Layout::Calculator::_resumeScanlineMaker()
+{
+    if (!_scanline_resume_pending) {
+        return;
+    }
+    _scanline_resume_pending = false;
+
+    unsigned const shape_index = _current_shape_index;
+    delete _scanline_maker;
+    _createFirstScanlineMaker();
+    while (_current_shape_index < shape_index && !_flow._input_wrap_shapes.empty()) {
+        _goToNextWrapShape();
+    }
+    _scanline_maker->setNewYCoordinate(_scanline_resume_y);
+}
+
 /** The management function to start the whole thing off. */
 bool Layout::Calculator::calculate()
 {
@@ -2118,7 +2460,7 @@ bool Layout::Calculator::calculate()
 
     _flow._clearOutputObjects();
 
-    _pango_context = FontFactory::get().get_font_context();
+    _pango_context = FontFactory::get().get_layout_context();
 
     _font_factory_size_multiplier = FontFactory::get().fontSize;
 
@@ -2152,6 +2494,22 @@ bool Layout::Calculator::calculate()
     _y_offset = 0.0;
     _createFirstScanlineMaker();
 
+    // Remember how each paragraph was made so that the next calculation can reuse it.
+    bool const record_checkpoints = _flow._incremental && !_flow.textLength._set;
+    PreviousOutput const *previous = nullptr;
+    _scanline_resume_pending = false;
+    if (record_checkpoints) {
+        _flow._flow_fingerprint = _flowFingerprint();
+        if (_flow._previous_output && _flow._previous_output->flow_fingerprint == _flow._flow_fingerprint) {
+            previous = _flow._previous_output.get();
+        }
+    }
+
+    // Once a paragraph at or after the edited one has been reused, the edit is behind us and the
+    // rest of the previous output follows on unchanged, so it is copied without fingerprinting.
+    ParagraphCheckpoint const *converged = nullptr;
+    long const input_delta = previous ? (long)_flow._input_stream.size() - (long)previous->input_size : 0;
+
     ParagraphInfo para;
     FontMetrics line_box_height; // Current value of line box height for line.
     bool keep_going = true; // Set false if we ran out of space and had to stash overflow.
@@ -2165,10 +2523,46 @@ bool Layout::Calculator::calculate()
                 if (!_goToNextWrapShape()) {
                     std::cerr << "Layout::Calculator::calculate: Found SHAPE_BREAK but out of shapes!" << std::endl;
                 }
+                _scanline_resume_pending = false;
                 continue; // Go to next paragraph (paragraph only contained control code).
             }
         }
 
+        ParagraphCheckpoint checkpoint;
+        if (record_checkpoints) {
+            checkpoint.first_input_index = para.first_input_index;
+            checkpoint.start = _outputSizes();
+
+            ParagraphCheckpoint const *old = nullptr;
+            if (converged && converged + 1 != previous->checkpoints.data() + previous->checkpoints.size()
+                && (long)(converged + 1)->first_input_index + input_delta == (long)para.first_input_index) {
+                old = converged + 1;
+                checkpoint.end_input_index = old->end_input_index + input_delta;
+                checkpoint.entry_state = old->entry_state;
+                checkpoint.input = old->input;
+            } else {
+                checkpoint.end_input_index = _findParagraphEnd(para.first_input_index);
+                checkpoint.entry_state = _entryState(keep_going);
+                checkpoint.input = _paragraphFingerprint(checkpoint.first_input_index, checkpoint.end_input_index);
+                old = previous ? _findReusableParagraph(*previous, checkpoint) : nullptr;
+            }
+            converged = old && _flow._paragraphs.size() >= _flow._first_dirty_paragraph ? old : nullptr;
+
+            if (old) {
+                TRACE(("reusing previous output for para #%lu\n", _flow._paragraphs.size()));
+                _reuseParagraph(*previous, *old, para.first_input_index, &keep_going);
+                checkpoint.end = _outputSizes();
+                checkpoint.exit_shape_index = old->exit_shape_index;
+                checkpoint.exit_scanline_y = old->exit_scanline_y;
+                checkpoint.exit_y_offset = old->exit_y_offset;
+                checkpoint.exit_keep_going = old->exit_keep_going;
+                para.first_input_index = checkpoint.end_input_index + 1;
+                _flow._checkpoints.push_back(std::move(checkpoint));
+                continue;
+            }
+            _resumeScanlineMaker();
+        }
+
         // Break things up into little pango units with unique direction, gravity, etc.
         _buildPangoItemizationForPara(&para);
 
@@ -2301,6 +2695,20 @@ bool Layout::Calculator::calculate()
         // dumpPangoItemsOut(&para);
         // dumpUnbrokenSpans(&para);
 
+        if (record_checkpoints) {
+            if (para_end_input_index != checkpoint.end_input_index) {
+                checkpoint.end_input_index = para_end_input_index;
+                checkpoint.input.clear(); // Never matches, so this paragraph is never reused.
+            }
+            _recordSpanTextRefs();
+            checkpoint.end = _outputSizes();
+            checkpoint.exit_shape_index = _current_shape_index;
+            checkpoint.exit_scanline_y = _scanline_maker->yCoordinate();
+            checkpoint.exit_y_offset = _y_offset;
+            checkpoint.exit_keep_going = keep_going;
+            _flow._checkpoints.push_back(std::move(checkpoint));
+        }
+
         para.free();
         para.first_input_index = para_end_input_index + 1;
     } // Loop over paras
@@ -2386,12 +2794,57 @@ bool Layout::calculateFlow()
         result = calc.calculate();
     }
 
+    _previous_output.reset();
+    _incremental = false;
+    _first_dirty_paragraph = -1;
+
     if (_characters.empty()) {
         _calculateCursorShapeForEmpty();
     }
     return result;
 }
 
+void Layout::calculateFlows(std::vector<Layout *> const &layouts)
+{
+    // Every worker has to load its fonts again through a font map of its own, so small batches
+    // are quicker done here.
+    constexpr std::size_t min_layouts_per_thread = 64;
+
+    auto const pool = Util::WorkerPool::get();
+    auto const numthreads = Preferences::get()->getIntLimited("/options/threading/numthreads", Util::default_numthreads(), 1, 256);
+    int const num_tasks = std::min<std::size_t>(std::min(numthreads, pool->size()), layouts.size() / min_layouts_per_thread);
+
+    if (num_tasks < 2) {
+        for (auto layout : layouts) {
+            layout->calculateFlow();
+        }
+        return;
+    }
+
+    // The calling thread only waits: it is the one thread allowed to use the shared pango context,
+    // and Face() may be loading fonts through the shared font map in the meantime. So the work is
+    // posted to the pool rather than dispatched, which would run part of it here.
+    std::atomic<std::size_t> next = 0;
+    std::mutex mutex;
+    std::condition_variable cond;
+    int finished = 0;
+
+    for (int task = 0; task < num_tasks; task++) {
+        pool->post([&] {
+            for (std::size_t i; (i = next++) < layouts.size();) {
+                layouts[i]->calculateFlow();
+            }
+            // Notified under the lock, since the waiting thread returns as soon as it sees the count.
+            auto lock = std::lock_guard(mutex);
+            finished++;
+            cond.notify_one();
+        });
+    }
+
+    auto lock = std::unique_lock(mutex);
+    cond.wait(lock, [&] { return finished == num_tasks; });
+}
+
 }//namespace Text
 }//namespace Inkscape
 
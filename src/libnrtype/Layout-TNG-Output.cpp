@@ -85,6 +85,9 @@ void Layout::_clearOutputObjects()
     _characters.clear();
     _glyphs.clear();
     _path_fitted = nullptr;
+    _checkpoints.clear();
+    _span_text_refs.clear();
+    _flow_fingerprint.clear();
 }
 
 void Layout::FontMetrics::set(FontInstance const *font)
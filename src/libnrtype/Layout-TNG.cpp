@@ -21,11 +21,13 @@ Layout::Layout() = default;
 
 Layout::~Layout()
 {
+    _incremental = false;
     clear();
 }
 
 void Layout::clear()
 {
+    _stashOutputForReflow();
     _clearInputObjects();
     _clearOutputObjects();
 
@@ -35,6 +37,38 @@ void Layout::clear()
      lengthAdjust = LENGTHADJUST_SPACING;
 }
 
+void Layout::markParagraphDirty(iterator const &position)
+{
+    _incremental = true;
+    if (!_paragraphs.empty()) {
+        _first_dirty_paragraph = std::min(_first_dirty_paragraph, paragraphIndex(position));
+    }
+}
+
+void Layout::_stashOutputForReflow()
+{
+    _previous_output.reset();
+
+    // Text on a path has its glyphs moved after calculateFlow(), so the output
+    // no longer matches what the calculator would produce.
+    if (!_incremental || _path_fitted || _checkpoints.empty()) {
+        return;
+    }
+
+    auto previous = std::make_unique<PreviousOutput>();
+    previous->flow_fingerprint = std::move(_flow_fingerprint);
+    previous->input_size = _input_stream.size();
+    previous->checkpoints = std::move(_checkpoints);
+    previous->span_text_refs = std::move(_span_text_refs);
+    previous->paragraphs = std::move(_paragraphs);
+    previous->lines = std::move(_lines);
+    previous->chunks = std::move(_chunks);
+    previous->spans = std::move(_spans);
+    previous->characters = std::move(_characters);
+    previous->glyphs = std::move(_glyphs);
+    _previous_output = std::move(previous);
+}
+
 bool Layout::_directions_are_orthogonal(Direction d1, Direction d2)
 {
     if (d1 == BOTTOM_TO_TOP) d1 = TOP_TO_BOTTOM;
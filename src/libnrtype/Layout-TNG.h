@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <vector>
 #include <optional>
+#include <string>
 #include <svg/svg-length.h>
 #include "helper/auto-connection.h"
 #include "style-enums.h"
@@ -351,6 +352,28 @@ public:
     */
     bool calculateFlow();
 
+    /** Calls calculateFlow() on each of \a layouts, spreading them over the
+    shared worker pool, on at most as many threads as the numthreads
+    preference allows, when there are enough to make that worthwhile. Returns
+    once all of them are done. The layouts must be independent of each
+    other, and nothing else may use the font factory's main context or any
+    of these layouts until this returns. Wrap shapes and the styles and
+    sources referenced by the input are only read.
+    */
+    static void calculateFlows(std::vector<Layout *> const &layouts);
+
+    /** Tells the layout that the text of the paragraph containing
+    \a position is about to be edited. The next calculateFlow() then only
+    has to re-flow from the first paragraph whose input changed, copying the
+    previous output for every paragraph before it whose input and starting
+    position turn out to be unchanged, and for all of the rest once one
+    paragraph at or after the edited one has been. It also remembers where
+    each paragraph started and what input produced it, for use by the
+    calculation after it if that is marked too. Every other calculation
+    starts from scratch.
+    */
+    void markParagraphDirty(iterator const &position);
+
     //@}
 
     // ************************** operating on the output glyphs *************************
@@ -681,6 +704,11 @@ private:
     /** Erases all the stuff output by computeFlow(). Glyphs and things. */
     void _clearOutputObjects();
 
+    /** Moves the current output to #_previous_output so that the next
+    calculateFlow() can reuse unchanged paragraphs. Must be called before
+    the input is cleared. See markParagraphDirty(). */
+    void _stashOutputForReflow();
+
     static const gunichar UNICODE_SOFT_HYPHEN;
 
     // ******************* input flow
@@ -885,6 +913,53 @@ private:
     std::vector<Character> _characters;
     std::vector<Glyph> _glyphs;
 
+    // ******************* incremental reflow
+
+    /** The state of the calculator at the start and end of one output
+    paragraph, and what it was calculated from. See markParagraphDirty(). */
+    struct ParagraphCheckpoint {
+        unsigned first_input_index;
+        unsigned end_input_index;   /// the control code ending the paragraph, or _input_stream.size()
+        struct OutputSizes {
+            unsigned paragraphs, lines, chunks, spans, characters, glyphs;
+        } start, end;
+        unsigned exit_shape_index;
+        double exit_scanline_y;
+        double exit_y_offset;
+        bool exit_keep_going;
+        std::string entry_state;    /// flow position and preceding span, serialised
+        std::string input;          /// everything in the input stream that affects the paragraph, serialised
+    };
+
+    /** Where a span's input_stream_first_character points, as an offset
+    into the text of an input item so that it survives rebuilding the input
+    stream. */
+    struct SpanTextRef {
+        static constexpr unsigned NONE = -1;
+        unsigned input_index = NONE;
+        std::size_t offset = 0;
+    };
+
+    struct PreviousOutput {
+        std::string flow_fingerprint;
+        unsigned input_size;
+        std::vector<ParagraphCheckpoint> checkpoints;
+        std::vector<SpanTextRef> span_text_refs;
+        std::vector<Paragraph> paragraphs;
+        std::vector<Line> lines;
+        std::vector<Chunk> chunks;
+        std::vector<Span> spans;
+        std::vector<Character> characters;
+        std::vector<Glyph> glyphs;
+    };
+
+    bool _incremental = false;
+    unsigned _first_dirty_paragraph = -1;
+    std::string _flow_fingerprint;
+    std::vector<ParagraphCheckpoint> _checkpoints;
+    std::vector<SpanTextRef> _span_text_refs;
+    std::unique_ptr<PreviousOutput> _previous_output;
+
     /// Gets the overall matrix that transforms the given glyph from local space to world space.
     void _getGlyphTransformMatrix(int glyph_index, Geom::Affine *matrix) const;
 
@@ -18,6 +18,7 @@
 #define PANGO_ENABLE_ENGINE
 #endif
 
+#include <cstdio>
 #include <unordered_map>
 
 #include <glibmm/i18n.h>
@@ -34,6 +35,7 @@
 #include "libnrtype/font-factory.h"
 #include "libnrtype/font-instance.h"
 #include "libnrtype/OpenTypeUtil.h"
+#include "libnrtype/shaping-cache.h"
 
 #include "util/statics.h"
 
@@ -216,6 +218,49 @@ FontFactory::FontFactory()
 #endif
 }
 
+namespace {
+
+/// A font map and context private to one layout thread.
+struct ThreadFontContext
+{
+    PangoFontMap *font_map = nullptr;
+    PangoContext *context = nullptr;
+
+    ~ThreadFontContext()
+    {
+        if (context) {
+            g_object_unref(context);
+            g_object_unref(font_map);
+        }
+    }
+};
+
+} // namespace
+
+PangoContext *FontFactory::get_layout_context()
+{
+    if (std::this_thread::get_id() == main_thread) {
+        return fontContext;
+    }
+
+    thread_local ThreadFontContext thread_context;
+    if (!thread_context.context) {
+        auto lock = std::lock_guard(mutex);
+        auto font_map = pango_ft2_font_map_new();
+        pango_ft2_font_map_set_resolution(PANGO_FT2_FONT_MAP(font_map), 72, 72);
+#if PANGO_VERSION_CHECK(1,48,0)
+        pango_fc_font_map_set_default_substitute(PANGO_FC_FONT_MAP(font_map), FactorySubstituteFunc, this, nullptr);
+#else
+        pango_ft2_font_map_set_default_substitute(PANGO_FT2_FONT_MAP(font_map), FactorySubstituteFunc, this, nullptr);
+#endif
+        // Share the configuration, so that fonts added with AddFontsDir() etc. are found here too.
+        pango_fc_font_map_set_config(PANGO_FC_FONT_MAP(font_map), pango_fc_font_map_get_config(PANGO_FC_FONT_MAP(fontServer)));
+        thread_context.font_map = font_map;
+        thread_context.context = pango_font_map_create_context(font_map);
+    }
+    return thread_context.context;
+}
+
 FontFactory::~FontFactory()
 {
     loaded.clear();
@@ -226,6 +271,7 @@ FontFactory::~FontFactory()
 void FontFactory::refreshConfig()
 {
     pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+    Inkscape::Text::ShapingCache::get().clear();
 }
 
 Glib::ustring FontFactory::ConstructFontSpecification(PangoFontDescription *font)
@@ -392,14 +438,14 @@ bool FontFactory::hasFontFamily(const std::string &family)
     return getSubstituteFontName(family) == family;
 }
 
-std::map <std::string, PangoFontFamily*> FontFactory::GetUIFamilies()
+std::map <std::string, PangoFontFamily*> FontFactory::GetUIFamilies(PangoFontMap *font_map)
 {
     std::map <std::string, PangoFontFamily*> out;
 
     // Gather the family names as listed by Pango
     PangoFontFamily **families = nullptr;
     int numFamilies = 0;
-    pango_font_map_list_families(fontServer, &families, &numFamilies);
+    pango_font_map_list_families(font_map ? font_map : fontServer, &families, &numFamilies);
 
     // not size_t
     for (int currentFamily = 0; currentFamily < numFamilies; ++currentFamily) {
@@ -596,6 +642,8 @@ std::shared_ptr<FontInstance> FontFactory::FaceFromFontSpecification(char const
 
 std::shared_ptr<FontInstance> FontFactory::Face(PangoFontDescription *descr, bool canFail)
 {
+    auto lock = std::lock_guard(mutex);
+
     // Mandatory huge size (hinting workaround).
     pango_font_description_set_size(descr, fontSize * PANGO_SCALE);
 
@@ -692,6 +740,7 @@ void FontFactory::AddFontsDir(char const *utf8dir)
     if (res == FcTrue) {
         g_info("Fonts dir '%s' added successfully.", utf8dir);
         pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+        Inkscape::Text::ShapingCache::get().clear();
     } else {
         g_warning("Could not add fonts dir '%s'.", utf8dir);
     }
@@ -719,6 +768,7 @@ void FontFactory::AddFontFile(char const *utf8file)
     if (res == FcTrue) {
         g_info("Font file '%s' added successfully.", utf8file);
         pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+        Inkscape::Text::ShapingCache::get().clear();
     } else {
         g_warning("Could not add font file '%s'.", utf8file);
     }
@@ -726,6 +776,46 @@ void FontFactory::AddFontFile(char const *utf8file)
     g_free(file);
 }
 
+std::string FontFactory::GetFontSetHash()
+{
+    // The font sets are read from fontconfig's caches when the configuration is loaded, so this
+    // takes no file access and is quick even with thousands of fonts.
+    FcConfig *conf = pango_fc_font_map_get_config(PANGO_FC_FONT_MAP(fontServer));
+
+    std::size_t hash = 0;
+    auto const add = [&hash] (std::size_t value) {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+
+    for (auto set_name : {FcSetSystem, FcSetApplication}) {
+        FcFontSet *set = FcConfigGetFonts(conf, set_name);
+        if (!set) {
+            continue;
+        }
+        add(set->nfont);
+        for (int i = 0; i < set->nfont; i++) {
+            // Besides the file, include the version and names of the font, which change when a
+            // font is updated in place, such as by a package upgrade.
+            for (auto object : {FC_FILE, FC_FAMILY, FC_STYLE}) {
+                FcChar8 *str = nullptr;
+                for (int n = 0; FcPatternGetString(set->fonts[i], object, n, &str) == FcResultMatch; n++) {
+                    add(g_str_hash(str));
+                }
+            }
+            for (auto object : {FC_INDEX, FC_FONTVERSION}) {
+                int value = 0;
+                if (FcPatternGetInteger(set->fonts[i], object, 0, &value) == FcResultMatch) {
+                    add(value);
+                }
+            }
+        }
+    }
+
+    char buf[2 * sizeof(hash) + 1];
+    std::snprintf(buf, sizeof(buf), "%0*zx", static_cast<int>(2 * sizeof(hash)), hash);
+    return buf;
+}
+
 bool FontFactory::Compare::operator()(PangoFontDescription const *a, PangoFontDescription const *b) const
 {
     // return pango_font_description_equal(a, b);
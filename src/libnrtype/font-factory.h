@@ -14,6 +14,8 @@
 #include <algorithm>
 #include <utility>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include <pango/pango.h>
 #include "style.h"
@@ -73,8 +75,8 @@ public:
     Glib::ustring GetUIStyleString(PangoFontDescription const *fontDescr);
     bool hasFontFamily(const std::string &family);
 
-    // Helpfully inserts all font families into the provided map.
-    std::map <std::string, PangoFontFamily*> GetUIFamilies();
+    // Helpfully inserts all font families into the provided map. Uses our own font map by default.
+    std::map <std::string, PangoFontFamily*> GetUIFamilies(PangoFontMap *font_map = nullptr);
     // Retrieves style information about a family in a newly allocated GList.
     GList *GetUIStyles(PangoFontFamily *in);
 
@@ -97,13 +99,28 @@ public:
     /// Add a an additional font.
     void AddFontFile(char const *utf8file);
 
+    /// Returns a hash of the files, names and versions of all fonts known to fontconfig, which changes whenever
+    /// fonts are added, removed or updated.
+    std::string GetFontSetHash();
+
     PangoContext *get_font_context() const { return fontContext; }
+
+    /**
+     * Return the context to use for text layout on the calling thread. This is the shared font
+     * context on the main thread. Other threads get a private font map and context of their own,
+     * since pango's are not thread-safe; they are released when the thread exits.
+     */
+    PangoContext *get_layout_context();
     PangoFontDescription *parsePostscriptName(std::string const &name, bool substitute);
 private:
     // Pango data. Backend-specific structures are cast to these opaque types.
     PangoFontMap *fontServer;
     PangoContext *fontContext;
 
+    // Serialises Face(), which loads fonts through fontServer and may be called from layout threads.
+    std::recursive_mutex mutex;
+    std::thread::id const main_thread = std::this_thread::get_id();
+
     // A hashmap of all the loaded font instances, indexed by their PangoFontDescription.
     // Note: Since pango already does that, using the PangoFont could work too.
     struct Hash
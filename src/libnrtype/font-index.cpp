@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * On-disk index of the installed font families and their styles.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "font-index.h"
+
+#include <sstream>
+
+#include <glib/gstdio.h>
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+
+namespace Inkscape {
+namespace FontIndex {
+
+namespace {
+
+// Bump whenever the format, or what GetUIStyles() returns for a family, changes.
+constexpr char const *HEADER = "inkscape-font-index 1";
+
+std::string index_filename()
+{
+    return Glib::build_filename(Glib::get_user_cache_dir(), "inkscape", "font-index");
+}
+
+// Names are escaped so that they cannot contain the tabs and newlines used as separators.
+std::string escape(Glib::ustring const &str)
+{
+    auto escaped = g_strescape(str.c_str(), nullptr);
+    std::string result = escaped;
+    g_free(escaped);
+    return result;
+}
+
+Glib::ustring unescape(std::string const &str)
+{
+    auto compressed = g_strcompress(str.c_str());
+    Glib::ustring result = compressed;
+    g_free(compressed);
+    return result;
+}
+
+} // namespace
+
+std::optional<Families> load(std::string const &hash)
+{
+    std::string contents;
+    try {
+        contents = Glib::file_get_contents(index_filename());
+    } catch (Glib::FileError const &) {
+        return {};
+    }
+
+    std::istringstream in(contents);
+    std::string line;
+    if (!std::getline(in, line) || line != HEADER || !std::getline(in, line) || line != hash) {
+        return {};
+    }
+
+    Families families;
+    std::vector<StyleNames> *styles = nullptr;
+    while (std::getline(in, line)) {
+        if (line.size() < 2 || line[1] != '\t') {
+            return {};
+        }
+        if (line[0] == 'F') {
+            styles = &families[unescape(line.substr(2)).raw()];
+        } else if (line[0] == 'S' && styles) {
+            auto const tab = line.find('\t', 2);
+            if (tab == std::string::npos) {
+                return {};
+            }
+            styles->emplace_back(unescape(line.substr(2, tab - 2)), unescape(line.substr(tab + 1)));
+        } else {
+            return {};
+        }
+    }
+
+    return families;
+}
+
+Families build()
+{
+    Families families;
+
+    auto &factory = FontFactory::get();
+    auto const font_map = pango_context_get_font_map(factory.get_layout_context());
+
+    for (auto const &[name, family] : factory.GetUIFamilies(font_map)) {
+        auto &styles = families[name];
+        GList *list = factory.GetUIStyles(family);
+        for (GList *l = list; l; l = l->next) {
+            auto style = static_cast<StyleNames *>(l->data);
+            styles.push_back(std::move(*style));
+            delete style;
+        }
+        g_list_free(list);
+    }
+
+    return families;
+}
+
+void save(std::string const &hash, Families const &families)
+{
+    std::ostringstream out;
+    out << HEADER << '\n' << hash << '\n';
+    for (auto const &[name, styles] : families) {
+        out << "F\t" << escape(name) << '\n';
+        for (auto const &style : styles) {
+            out << "S\t" << escape(style.CssName) << '\t' << escape(style.DisplayName) << '\n';
+        }
+    }
+
+    auto const filename = index_filename();
+    auto const dir = Glib::path_get_dirname(filename);
+    if (g_mkdir_with_parents(dir.c_str(), 0700) != 0) {
+        g_warning("Could not create directory '%s' for the font index.", dir.c_str());
+        return;
+    }
+
+    auto const contents = out.str();
+    GError *error = nullptr;
+    if (!g_file_set_contents(filename.c_str(), contents.data(), contents.size(), &error)) {
+        g_warning("Could not save the font index: %s", error->message);
+        g_error_free(error);
+    }
+}
+
+} // namespace FontIndex
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8 :
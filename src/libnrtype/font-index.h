@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * On-disk index of the installed font families and their styles.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+#ifndef LIBNRTYPE_FONT_INDEX_H
+#define LIBNRTYPE_FONT_INDEX_H
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "font-factory.h"
+
+namespace Inkscape {
+namespace FontIndex {
+
+/**
+ * The installed font families, each with the styles GetUIStyles() reports for it.
+ *
+ * Enumerating these through pango means listing every face of every family, which takes seconds
+ * with thousands of fonts installed. So FontLister keeps the result in the user's cache directory
+ * instead, tagged with FontFactory::GetFontSetHash(), and only enumerates again when the installed
+ * fonts have changed.
+ */
+using Families = std::map<std::string, std::vector<StyleNames>>;
+
+/// Load the saved index, provided it was made for the font set with the given hash.
+std::optional<Families> load(std::string const &hash);
+
+/// Enumerate all families and their styles through pango. Meant to be called off the main thread.
+Families build();
+
+/// Save the index for the font set with the given hash, replacing the previous one.
+void save(std::string const &hash, Families const &families);
+
+} // namespace FontIndex
+} // namespace Inkscape
+
+#endif // LIBNRTYPE_FONT_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8 :
@@ -390,6 +390,8 @@ FontGlyph const *FontInstance::LoadGlyph(int glyph_id)
         return nullptr; // bitmap font
     }
 
+    auto lock = std::lock_guard(data->mutex);
+
     if (auto it = data->glyphs.find(glyph_id); it != data->glyphs.end()) {
         return it->second.get(); // already loaded
     }
@@ -528,6 +530,8 @@ Geom::PathVector const *FontInstance::PathVector(int glyph_id)
 
 Inkscape::Pixbuf const *FontInstance::PixBuf(int glyph_id)
 {
+    auto lock = std::lock_guard(data->mutex);
+
     auto glyph_iter = data->openTypeSVGGlyphs.find(glyph_id);
     if (glyph_iter == data->openTypeSVGGlyphs.end()) {
         return nullptr; // out of range
@@ -650,6 +654,7 @@ double FontInstance::Advance(int glyph_id, bool vertical)
 
 std::map<Glib::ustring, OTSubstitution> const &FontInstance::get_opentype_tables()
 {
+    auto lock = std::lock_guard(data->mutex);
     if (!data->openTypeTables) {
         auto hb_font = pango_font_get_hb_font(p_font);
         assert(hb_font);
@@ -11,6 +11,7 @@
 #define LIBNRTYPE_FONT_INSTANCE_H
 
 #include <map>
+#include <mutex>
 #include <vector>
 #include <optional>
 #include <unordered_map>
@@ -57,6 +58,7 @@ public:
 
     // Loads the given glyph's info. Glyphs are lazy-loaded, but never unloaded or modified
     // as long as the FontInstance still exists. Pointers to FontGlyphs also remain valid.
+    // Safe to call from several threads at once.
     FontGlyph const *LoadGlyph(int glyph_id);
 
     // nota: all coordinates returned by these functions are on a [0..1] scale; you need to multiply
@@ -165,6 +167,9 @@ private:
 
         // Lookup table mapping pango glyph ids to glyphs.
         std::unordered_map<int, std::unique_ptr<FontGlyph const>> glyphs;
+
+        // Guards the lazy-loaded members above and the FT_Face, which is not thread-safe.
+        std::mutex mutex;
     };
 
     std::shared_ptr<Data> data;
@@ -17,6 +17,7 @@
 #include <libnrtype/font-instance.h>
 
 #include "font-factory.h"
+#include "async/async.h"
 #include "desktop.h"
 #include "desktop-style.h"
 #include "document.h"
@@ -61,7 +62,7 @@ FontLister::FontLister()
     default_styles = g_list_append(default_styles, new StyleNames("Bold"));
     default_styles = g_list_append(default_styles, new StyleNames("Bold Italic"));
 
-    pango_family_map = FontFactory::get().GetUIFamilies();
+    update_font_families();
     init_font_families();
 
     style_list_store = Gtk::ListStore::create(FontStyleList);
@@ -71,7 +72,7 @@ FontLister::FontLister()
     if (auto settings = Gtk::Settings::get_default()) {
         settings->property_gtk_fontconfig_timestamp().signal_changed().connect([this]() {
             FontFactory::get().refreshConfig();
-            pango_family_map = FontFactory::get().GetUIFamilies();
+            update_font_families();
             init_font_families(-1);
             new_fonts_signal.emit();
         });
@@ -94,6 +95,52 @@ FontLister::~FontLister()
     }
 }
 
+void FontLister::update_font_families()
+{
+    auto hash = FontFactory::get().GetFontSetHash();
+
+    if (auto families = FontIndex::load(hash)) {
+        font_index = std::move(*families);
+        font_index_channel.close();
+        pango_family_map.clear();
+        for (auto const &family : font_index) {
+            pango_family_map.emplace(family.first, nullptr);
+        }
+        return;
+    }
+
+    font_index.clear();
+    pango_family_map = FontFactory::get().GetUIFamilies();
+
+    auto [src, dst] = Async::Channel::create();
+    font_index_channel = std::move(dst);
+
+    Async::fire_and_forget([this, hash = std::move(hash), channel = std::move(src)] {
+        auto families = FontIndex::build();
+        FontIndex::save(hash, families);
+        channel.run([this, families = std::move(families)] () mutable {
+            font_index = std::move(families);
+        });
+    });
+}
+
+GList *FontLister::get_system_styles(Gtk::TreeModel::Row const &row)
+{
+    if (auto it = font_index.find(Glib::ustring(row[FontList.family]).raw()); it != font_index.end()) {
+        GList *styles = nullptr;
+        for (auto const &style : it->second) {
+            styles = g_list_append(styles, new StyleNames(style));
+        }
+        return styles;
+    }
+
+    if (PangoFontFamily *family = row[FontList.pango_family]) {
+        return FontFactory::get().GetUIStyles(family);
+    }
+
+    return nullptr;
+}
+
 int FontLister::get_font_families_size() {
     return pango_family_map.size();
 }
@@ -296,8 +343,8 @@ void FontLister::ensureRowStyles(Glib::RefPtr<Gtk::TreeModel> model, Gtk::TreeMo
 {
     Gtk::TreeModel::Row row = *iter;
     if (!row[FontList.styles]) {
-        if (row[FontList.pango_family]) {
-            row[FontList.styles] = FontFactory::get().GetUIStyles(row[FontList.pango_family]);
+        if (auto styles = get_system_styles(row)) {
+            row[FontList.styles] = styles;
         } else {
             row[FontList.styles] = default_styles;
         }
@@ -387,7 +434,7 @@ void FontLister::insert_font_family(Glib::ustring const &new_family)
 
             if (row[FontList.onSystem] && familyNamesAreEqual(tokens[0], row[FontList.family])) {
                 if (!row_styles) {
-                    row_styles = FontFactory::get().GetUIStyles(row[FontList.pango_family]);
+                    row_styles = get_system_styles(row);
                 }
                 styles = row_styles;
                 break;
@@ -457,7 +504,7 @@ int FontLister::add_document_fonts_at_top(SPDocument *document)
             if (row[FontList.onSystem] && familyNamesAreEqual(tokens[0], row[FontList.family])) {
                 // Found font on system, set style list to system font style list.
                 if (!row_styles) {
-                    row_styles = FontFactory::get().GetUIStyles(row[FontList.pango_family]);
+                    row_styles = get_system_styles(row);
                 }
 
                 // Add new styles (from 'font-variation-settings', these are not include in GetUIStyles()).
@@ -803,7 +850,7 @@ std::pair<Glib::ustring, Glib::ustring> FontLister::new_font_family(Glib::ustrin
         auto row_styles = row[FontList.styles];
         if (familyNamesAreEqual(new_family, row[FontList.family])) {
             if (!row_styles) {
-                row_styles = FontFactory::get().GetUIStyles(row[FontList.pango_family]);
+                row_styles = get_system_styles(row);
             }
             styles = row_styles;
             break;
@@ -1214,7 +1261,7 @@ Glib::ustring FontLister::get_best_style_match(Glib::ustring const &family, Glib
 
     GList *styles = default_styles;
     if (row[FontList.onSystem] && !row[FontList.styles]) {
-        row[FontList.styles] = FontFactory::get().GetUIStyles(row[FontList.pango_family]);
+        row[FontList.styles] = get_system_styles(row);
         styles = row[FontList.styles];
     }
 
@@ -27,6 +27,9 @@
 #include <gtkmm/treemodelcolumn.h>
 #include <gtkmm/treepath.h>
 
+#include "async/channel.h"
+#include "libnrtype/font-index.h"
+
 #define FONT_FAMILIES_GROUP_SIZE 30
 
 class SPObject;
@@ -142,7 +145,7 @@ public:
     FontStyleListClass FontStyleList;
 
     // This map will give constant time access to each font and it's
-    // PangoFontFamily.
+    // PangoFontFamily. The PangoFontFamily is null if the family was read from the font index.
     std::map <std::string, PangoFontFamily *> pango_family_map;
 
     /** 
@@ -335,6 +338,25 @@ public:
 private:
     FontLister();
 
+    /**
+     * Fill pango_family_map, from the saved font index if it is up to date. Otherwise ask pango,
+     * and rebuild the index in the background.
+     */
+    void update_font_families();
+
+    /**
+     * Return a newly allocated list of the styles of the system font family in the row,
+     * or nullptr if there are none.
+     */
+    GList *get_system_styles(Gtk::TreeModel::Row const &row);
+
+    /**
+     * The families and styles saved by a previous session, or built in the background by this
+     * one. Empty until either is available, in which case styles are looked up through pango.
+     */
+    FontIndex::Families font_index;
+    Async::Channel::Dest font_index_channel;
+
     void update_font_data_recursive(SPObject& r, std::map<Glib::ustring, std::set<Glib::ustring>> &font_data);
 
 	void font_family_row_update(int start=0);
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Process-wide cache of shaped glyph runs.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "shaping-cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Inkscape {
+namespace Text {
+
+namespace {
+
+/// Number of characters either side of a run that HarfBuzz uses as context (HB_BUFFER_CONTEXT_LENGTH).
+constexpr int CONTEXT_CHARS = 5;
+
+void copy_glyphs(PangoGlyphString const *from, PangoGlyphString *to)
+{
+    pango_glyph_string_set_size(to, from->num_glyphs);
+    std::copy(from->glyphs, from->glyphs + from->num_glyphs, to->glyphs);
+    std::copy(from->log_clusters, from->log_clusters + from->num_glyphs, to->log_clusters);
+}
+
+} // namespace
+
+ShapingCache &ShapingCache::get()
+{
+    static ShapingCache cache;
+    return cache;
+}
+
+ShapingCache::~ShapingCache()
+{
+    for (auto &entry : entries) {
+        pango_glyph_string_free(entry.glyphs);
+    }
+}
+
+std::string ShapingCache::make_key(std::string_view text, std::string_view context_before,
+                                   std::string_view context_after, PangoAnalysis const *analysis)
+{
+    std::string key;
+
+    // Anything other than font features in the extra attributes could change the shaping in ways
+    // we don't track. Such runs are simply not cached.
+    std::string features;
+    for (GSList *l = analysis->extra_attrs; l; l = l->next) {
+        auto attr = static_cast<PangoAttribute const *>(l->data);
+        if (attr->klass->type != PANGO_ATTR_FONT_FEATURES) {
+            return key;
+        }
+        features += reinterpret_cast<PangoAttrFontFeatures const *>(attr)->features;
+        features += ';';
+    }
+
+    std::string font;
+    if (analysis->font) {
+        PangoFontDescription *descr = pango_font_describe(analysis->font);
+        char *str = pango_font_description_to_string(descr);
+        font = str;
+        g_free(str);
+        pango_font_description_free(descr);
+    }
+
+    char const *language = analysis->language ? pango_language_to_string(analysis->language) : "";
+
+    // Fields are separated by NUL, which cannot occur in the text itself.
+    key.reserve(text.size() + context_before.size() + context_after.size() + font.size() + features.size() + 32);
+    key.append(font).push_back('\0');
+    key.append(features).push_back('\0');
+    key.append(language).push_back('\0');
+    key.push_back(static_cast<char>(analysis->level));
+    key.push_back(static_cast<char>(analysis->gravity));
+    key.push_back(static_cast<char>(analysis->flags));
+    key.append(std::to_string(analysis->script)).push_back('\0');
+    key.append(context_before).push_back('\0');
+    key.append(text).push_back('\0');
+    key.append(context_after);
+    return key;
+}
+
+bool ShapingCache::shape(char const *paragraph_text, int paragraph_length, int item_offset, int item_length,
+                         PangoAnalysis const *analysis, PangoGlyphString *glyphs)
+{
+    if (paragraph_length < 0) {
+        paragraph_length = std::strlen(paragraph_text);
+    }
+
+    char const *item_text = paragraph_text + item_offset;
+    char const *para_end = paragraph_text + paragraph_length;
+
+    char const *before = item_text;
+    for (int i = 0; i < CONTEXT_CHARS && before > paragraph_text; ++i) {
+        before = g_utf8_find_prev_char(paragraph_text, before);
+    }
+    char const *after = item_text + item_length;
+    for (int i = 0; i < CONTEXT_CHARS && after < para_end; ++i) {
+        after = g_utf8_next_char(after);
+    }
+    after = std::min(after, para_end);
+
+    auto key = make_key({item_text, static_cast<std::size_t>(item_length)},
+                        {before, static_cast<std::size_t>(item_text - before)},
+                        {item_text + item_length, static_cast<std::size_t>(after - item_text - item_length)},
+                        analysis);
+
+    if (!key.empty()) {
+        auto lock = std::lock_guard(mutex);
+        if (auto it = index.find(key); it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            copy_glyphs(it->second->glyphs, glyphs);
+            return true;
+        }
+    }
+
+    pango_shape_full(item_text, item_length, paragraph_text, paragraph_length, analysis, glyphs);
+
+    if (key.empty() || static_cast<std::size_t>(glyphs->num_glyphs) > max_glyphs / 16) {
+        return false;
+    }
+
+    auto lock = std::lock_guard(mutex);
+    if (index.find(key) == index.end()) { // Another thread may have got there first.
+        entries.push_front({std::move(key), pango_glyph_string_copy(glyphs)});
+        index.emplace(entries.front().key, entries.begin());
+        num_glyphs += glyphs->num_glyphs;
+        evict();
+    }
+    return false;
+}
+
+void ShapingCache::evict()
+{
+    while (num_glyphs > max_glyphs && !entries.empty()) {
+        auto &entry = entries.back();
+        num_glyphs -= entry.glyphs->num_glyphs;
+        index.erase(entry.key);
+        pango_glyph_string_free(entry.glyphs);
+        entries.pop_back();
+    }
+}
+
+void ShapingCache::clear()
+{
+    auto lock = std::lock_guard(mutex);
+    index.clear();
+    for (auto &entry : entries) {
+        pango_glyph_string_free(entry.glyphs);
+    }
+    entries.clear();
+    num_glyphs = 0;
+}
+
+std::size_t ShapingCache::size() const
+{
+    auto lock = std::lock_guard(mutex);
+    return entries.size();
+}
+
+} // namespace Text
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8 :
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Process-wide cache of shaped glyph runs.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+#ifndef LIBNRTYPE_SHAPING_CACHE_H
+#define LIBNRTYPE_SHAPING_CACHE_H
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <pango/pango.h>
+
+namespace Inkscape {
+namespace Text {
+
+/**
+ * Remembers the output of pango_shape_full() so that laying out the same run of text with the
+ * same font, features, language and direction does not have to go through HarfBuzz again.
+ *
+ * The key contains the text of the run plus the few characters on either side of it that
+ * HarfBuzz looks at for context, so runs are shared between unrelated paragraphs (e.g. thousands
+ * of identical table cells) without ever returning a result that pango would have shaped
+ * differently.
+ *
+ * The cache is bounded by the total number of glyphs it holds and evicts the least recently
+ * used runs first. All methods are thread-safe.
+ */
+class ShapingCache
+{
+public:
+    static ShapingCache &get();
+
+    /**
+     * Shape @a item_length bytes of @a paragraph_text starting at @a item_offset, exactly as
+     * pango_shape_full() would, writing the result into @a glyphs. Returns true if the result
+     * came from the cache.
+     */
+    bool shape(char const *paragraph_text, int paragraph_length, int item_offset, int item_length,
+               PangoAnalysis const *analysis, PangoGlyphString *glyphs);
+
+    /// Drop all cached runs. Must be called whenever the set of available fonts changes.
+    void clear();
+
+    std::size_t size() const;
+
+private:
+    ShapingCache() = default;
+    ~ShapingCache();
+    ShapingCache(ShapingCache const &) = delete;
+    ShapingCache &operator=(ShapingCache const &) = delete;
+
+    struct Entry
+    {
+        std::string key;
+        PangoGlyphString *glyphs;
+    };
+
+    static std::string make_key(std::string_view text, std::string_view context_before,
+                                std::string_view context_after, PangoAnalysis const *analysis);
+    void evict();
+
+    /// Upper bound on the number of glyphs held in the cache (roughly 20 bytes each).
+    static constexpr std::size_t max_glyphs = 1 << 19;
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // Most recently used first.
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    std::size_t num_glyphs = 0;
+};
+
+} // namespace Text
+} // namespace Inkscape
+
+#endif // LIBNRTYPE_SHAPING_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8 :
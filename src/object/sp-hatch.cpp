@@ -559,6 +559,7 @@ Inkscape::DrawingPattern *SPHatch::show(Inkscape::Drawing &drawing, unsigned key
     views.emplace_back(make_drawingitem<Inkscape::DrawingPattern>(drawing), bbox, key);
     auto &v = views.back();
     auto ai = v.drawingitem.get();
+    ai->setContent(this);
 
     auto children = hatchPaths();
 
@@ -21,6 +21,7 @@
 #include <cstring>
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include <glibmm.h>
 #include <glib/gstdio.h>
@@ -46,6 +47,7 @@
 #include "display/cairo-utils.h"
 #include "display/curve.h"
 #include "io/sys.h"
+#include "util/worker-pool.h"
 #include "xml/quote.h"
 #include "xml/href-attribute-helper.h"
 
@@ -120,7 +122,6 @@ SPImage::SPImage() : SPItem(), SPViewBox() {
     this->prev_width = 0.0;
     this->prev_height = 0.0;
 
-    this->href = nullptr;
     this->color_profile = nullptr;
 }
 
@@ -148,11 +149,6 @@ void SPImage::release() {
         this->document->removeResource("image", this);
     }
 
-    if (this->href) {
-        g_free (this->href);
-        this->href = nullptr;
-    }
-
     pixbuf.reset();
 
     if (this->color_profile) {
@@ -168,8 +164,6 @@ void SPImage::release() {
 void SPImage::set(SPAttr key, const gchar* value) {
     switch (key) {
         case SPAttr::XLINK_HREF:
-            g_free (this->href);
-            this->href = (value) ? g_strdup (value) : nullptr;
             this->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_IMAGE_HREF_MODIFIED_FLAG);
             break;
 
@@ -284,26 +278,21 @@ void SPImage::apply_profile(Inkscape::Pixbuf *pixbuf) {
                         intent = INTENT_PERCEPTUAL;
                 }
                                 
-                cmsHPROFILE destProf = cmsCreate_sRGBProfile();
-                cmsHTRANSFORM transf = cmsCreateTransform( prof,
-                                                           TYPE_RGBA_8,
-                                                           destProf,
-                                                           TYPE_RGBA_8,
-                                                           intent, 0 );
-                if ( transf ) {
-                    guchar* currLine = px;
-                    for ( int y = 0; y < imageheight; y++ ) {
-                        // Since the types are the same size, we can do the transformation in-place
-                        cmsDoTransform( transf, currLine, currLine, imagewidth );
-                        currLine += rowstride;
-                    }
-
-                    cmsDeleteTransform( transf );
+                if (auto transf = Inkscape::CMSSystem::get()->get_transform_to_srgb(prof, intent)) {
+                    // Since the types are the same size, we can do the transformation in-place.
+                    // Large images are split into bands of rows, converted in parallel.
+                    constexpr int min_band_pixels = 256 * 256;
+                    int num_bands = Inkscape::Preferences::get()->getIntLimited("/options/threading/numthreads", Inkscape::Util::default_numthreads(), 1, 256);
+                    num_bands = std::max(1, std::min(num_bands, int(std::size_t(imagewidth) * imageheight / min_band_pixels)));
+
+                    Inkscape::Util::WorkerPool::get()->dispatch(num_bands, num_bands, [&] (int i, int) {
+                        for (int y = imageheight * i / num_bands; y < imageheight * (i + 1) / num_bands; y++) {
+                            transf->transform(px + std::size_t(y) * rowstride, imagewidth);
+                        }
+                    });
                 } else {
                     DEBUG_MESSAGE( lcmsSix, "in <image>'s sp_image_update. Unable to create LCMS transform." );
                 }
-
-                cmsCloseProfile( destProf );
             } else {
                 DEBUG_MESSAGE( lcmsSeven, "in <image>'s sp_image_update. Profile type is named color. Can't transform." );
             }
@@ -318,16 +307,14 @@ void SPImage::update(SPCtx *ctx, unsigned int flags) {
 
     if (flags & SP_IMAGE_HREF_MODIFIED_FLAG) {
         pixbuf.reset();
-        if (href) {
+        if (auto const href = getHref()) {
             Inkscape::Pixbuf *pb = nullptr;
             double svgdpi = 96;
             if (getRepr()->attribute("inkscape:svg-dpi")) {
                 svgdpi = g_ascii_strtod(getRepr()->attribute("inkscape:svg-dpi"), nullptr);
             }
             dpi = svgdpi;
-            pb = readImage(Inkscape::getHrefAttribute(*getRepr()).second,
-                           getRepr()->attribute("sodipodi:absref"),
-                           document->getDocumentBase(), svgdpi);
+            pb = readImage(href, getRepr()->attribute("sodipodi:absref"), document->getDocumentBase(), svgdpi);
             if (!pb) {
                 missing = true;
                 // Passing in our previous size allows us to preserve the image's expected size.
@@ -448,7 +435,9 @@ Inkscape::XML::Node *SPImage::write(Inkscape::XML::Document *xml_doc, Inkscape::
         repr = xml_doc->createElement("svg:image");
     }
 
-    Inkscape::setHrefAttribute(*repr, this->href);
+    if (repr != getRepr()) {
+        Inkscape::setHrefAttribute(*repr, getHref());
+    }
 
     /* fixme: Reset attribute if needed (Lauris) */
     if (this->x._set) {
@@ -522,10 +511,10 @@ const char* SPImage::displayName() const {
 gchar* SPImage::description() const {
     char *href_desc;
 
-    if (this->href) {
-        href_desc = (strncmp(this->href, "data:", 5) == 0)
+    if (auto const href = getHref()) {
+        href_desc = (strncmp(href, "data:", 5) == 0)
             ? g_strdup(_("embedded"))
-            : xml_quote_strdup(this->href);
+            : xml_quote_strdup(href);
     } else {
         g_warning("Attempting to call strncmp() with a null pointer.");
         href_desc = g_strdup("(null_pointer)"); // we call g_free() on href_desc
@@ -866,9 +855,14 @@ void sp_embed_svg(Inkscape::XML::Node *image_node, std::string const &fn)
     }
 }
 
+char const *SPImage::getHref() const
+{
+    return getRepr() ? Inkscape::getHrefAttribute(*getRepr()).second : nullptr;
+}
+
 void SPImage::refresh_if_outdated()
 {
-    if ( href && pixbuf && pixbuf->modificationTime()) {
+    if ( getHref() && pixbuf && pixbuf->modificationTime()) {
         // It *might* change
 
         GStatBuf st;
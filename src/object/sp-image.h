@@ -45,7 +45,6 @@ public:
 
     std::optional<SPCurve> curve; // This curve is at the image's boundary for snapping
 
-    char *href;
     char *color_profile;
 
     std::shared_ptr<Inkscape::Pixbuf const> pixbuf;
@@ -69,6 +68,9 @@ public:
 
     void apply_profile(Inkscape::Pixbuf *pixbuf);
 
+    /// The href of the image, read from the XML. Not kept as a copy, since embedded images make it huge.
+    char const *getHref() const;
+
     SPCurve const *get_curve() const;
     void refresh_if_outdated();
     bool cropToArea(Geom::Rect area);
@@ -399,6 +399,9 @@ void SPPattern::attach_view(Inkscape::DrawingPattern *di, unsigned key)
 {
     attached_views.push_back({di, key});
 
+    // All patterns showing these children can share their rendered tiles.
+    di->setContent(this);
+
     for (auto &c : children) {
         if (auto child = cast<SPItem>(&c)) {
             auto item = child->invoke_show(di->drawing(), key, SP_ITEM_SHOW_DISPLAY);
@@ -414,6 +417,8 @@ void SPPattern::unattach_view(Inkscape::DrawingPattern *di)
     });
     assert(it != attached_views.end());
 
+    di->setContent(nullptr);
+
     for (auto &c : children) {
         if (auto child = cast<SPItem>(&c)) {
             child->invoke_hide(it->key);
@@ -193,19 +193,30 @@ void SPText::update(SPCtx *ctx, guint flags) {
         /* fixme: It is not nice to have it here, but otherwise children content changes does not work */
         /* fixme: Even now it may not work, as we are delayed */
         /* fixme: So check modification flag everywhere immediate state is used */
-        this->rebuildLayout();
+        this->prepareLayout();
+        if (document->queueTextLayout(this)) {
+            // The bounding box is only known once the flow has been calculated, see finishLayout().
+            _layout_queued = true;
+        } else {
+            layout.calculateFlow();
+            this->finishLayout();
+            _showLayout();
+        }
+    }
+}
 
-        Geom::OptRect paintbox = this->geometricBounds();
+void SPText::_showLayout()
+{
+    Geom::OptRect paintbox = this->geometricBounds();
 
-        for (auto &v : views) {
-            auto &sa = view_style_attachments[v.key];
-            sa.unattachAll();
-            auto g = cast<Inkscape::DrawingGroup>(v.drawingitem.get());
-            _clearFlow(g);
-            g->setStyle(style, parent->style);
-            // pass the bbox of this as paintbox (used for paintserver fills)
-            layout.show(g, sa, paintbox);
-        }
+    for (auto &v : views) {
+        auto &sa = view_style_attachments[v.key];
+        sa.unattachAll();
+        auto g = cast<Inkscape::DrawingGroup>(v.drawingitem.get());
+        _clearFlow(g);
+        g->setStyle(style, parent->style);
+        // pass the bbox of this as paintbox (used for paintserver fills)
+        layout.show(g, sa, paintbox);
     }
 }
 
@@ -885,15 +896,23 @@ SPCurve SPText::getNormalizedBpath() const
 }
 
 void SPText::rebuildLayout()
+{
+    prepareLayout();
+    layout.calculateFlow();
+    finishLayout();
+}
+
+void SPText::prepareLayout()
 {
     layout.clear();
     _buildLayoutInit();
 
     Inkscape::Text::Layout::OptionalTextTagAttrs optional_attrs;
     _buildLayoutInput(this, optional_attrs, 0, false);
+}
 
-    layout.calculateFlow();
-
+void SPText::finishLayout()
+{
     for (auto& child: children) {
         if (is<SPTextPath>(&child)) {
             SPTextPath const *textpath = cast<SPTextPath>(&child);
@@ -922,6 +941,11 @@ void SPText::rebuildLayout()
             }
         }
     }
+
+    if (_layout_queued) {
+        _layout_queued = false;
+        _showLayout();
+    }
 }
 
 
@@ -47,6 +47,12 @@ public:
     /** Completely recalculates the layout. */
     void rebuildLayout();
 
+    /** The parts of rebuildLayout() before and after layout.calculateFlow(), for when the flow
+    is calculated as part of a batch. See SPDocument::queueTextLayout(). After a batched
+    calculation, finishLayout() also shows the new layout in every view. */
+    void prepareLayout();
+    void finishLayout();
+
     //semiprivate:  (need to be accessed by the C-style functions still)
     TextTagAttributes attributes;
     Inkscape::Text::Layout layout;
@@ -88,6 +94,12 @@ public:
 
 private:
 
+    /** Set while the flow is left to SPDocument to calculate, until finishLayout(). */
+    bool _layout_queued = false;
+
+    /** Shows the layout in every view, with the text's bounding box as the paint box. */
+    void _showLayout();
+
     /** Initializes layout from <text> (i.e. this node). */
     void _buildLayoutInit();
 
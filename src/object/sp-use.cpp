@@ -319,6 +319,7 @@ Inkscape::DrawingItem* SPUse::show(Inkscape::Drawing &drawing, unsigned int key,
 
         Geom::Translate t(this->x.computed, this->y.computed);
         ai->setChildTransform(t);
+        ai->setInstanceKey(instance_key());
     }
 
     return ai;
@@ -614,11 +615,13 @@ void SPUse::href_changed() {
 
                 this->child->invoke_build(refobj->document, childrepr, TRUE);
 
+                auto const key = instance_key();
                 for (auto &v : views) {
                     auto ai = this->child->invoke_show(v.drawingitem->drawing(), v.key, v.flags);
                     if (ai) {
                         v.drawingitem->prependChild(ai);
                     }
+                    cast<Inkscape::DrawingGroup>(v.drawingitem.get())->setInstanceKey(key);
                 }
 
                 this->_delete_connection = refobj->connectDelete(
@@ -635,6 +638,36 @@ void SPUse::href_changed() {
     }
 }
 
+/**
+ * Identify what the clone displays, apart from its position. Clones with the same key share a
+ * single rendering of their content on the canvas, see DrawingGroup::setInstanceKey().
+ *
+ * The content is determined by the original, the style it inherits from the clone, and for
+ * symbols and nested svg elements also the size of the viewport. The style is only written out
+ * again after it changed, since this is called on every update of the clone.
+ */
+std::optional<Inkscape::InstanceKey> SPUse::instance_key()
+{
+    auto const original = ref->getObject();
+    if (!child || !original) {
+        return {};
+    }
+
+    auto prefs = Inkscape::Preferences::get();
+    if (!prefs->getBool("/options/rendering/instancing", true)) {
+        return {};
+    }
+
+    if (!_instance_style) {
+        _instance_style = style->write(SP_STYLE_FLAG_ALWAYS).raw();
+    }
+    auto key = Inkscape::InstanceKey{original, *_instance_style, {}};
+    if (is<SPSymbol>(child) || is<SPRoot>(child)) {
+        key.viewport = {width.computed, height.computed};
+    }
+    return key;
+}
+
 void SPUse::delete_self() {
     // always delete uses which are used in flowtext
     if (parent && cast<SPFlowregion>(parent)) {
@@ -693,6 +726,19 @@ void SPUse::update(SPCtx *ctx, unsigned flags) {
         }
     }
 
+    // The key only changes with the style, and for symbols and nested svg elements with the
+    // viewport, which any modification may have changed.
+    if (flags & SP_OBJECT_STYLE_MODIFIED_FLAG) {
+        _instance_style.reset();
+    }
+    bool const has_viewport = is<SPSymbol>(child) || is<SPRoot>(child);
+    if ((flags & SP_OBJECT_STYLE_MODIFIED_FLAG || (flags & SP_OBJECT_MODIFIED_FLAG && has_viewport)) && !views.empty()) {
+        auto const key = instance_key();
+        for (auto &v : views) {
+            cast<Inkscape::DrawingGroup>(v.drawingitem.get())->setInstanceKey(key);
+        }
+    }
+
     /* As last step set additional transform of arena group */
     for (auto &v : views) {
         auto g = cast<Inkscape::DrawingGroup>(v.drawingitem.get());
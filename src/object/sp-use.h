@@ -17,6 +17,8 @@
  */
 
 #include <cstddef>
+#include <optional>
+#include <string>
 #include <sigc++/sigc++.h>
 
 #include "svg/svg-length.h"
@@ -26,6 +28,10 @@
 
 class SPUseReference;
 
+namespace Inkscape {
+struct InstanceKey;
+} // namespace Inkscape
+
 class SPUse final : public SPItem, public SPDimensions {
 public:
 	SPUse();
@@ -78,6 +84,9 @@ public:
     bool anyInChain(bool (*predicate)(SPItem const *)) const;
 
 private:
+    std::optional<std::string> _instance_style; ///< Style part of instance_key(), written again only when the style changes.
+
+    std::optional<Inkscape::InstanceKey> instance_key();
     void href_changed();
     void move_compensate(Geom::Affine const *mp);
     void delete_self();
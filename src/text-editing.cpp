@@ -55,12 +55,29 @@ Inkscape::Text::Layout const * te_get_layout (SPItem const *item)
     return nullptr;
 }
 
-static void te_update_layout_now (SPItem *item)
+/** Tells the layout of \a item that the paragraph at \a position is about to
+be edited, so that the relayout afterwards can skip unchanged paragraphs. */
+static void te_mark_paragraph_dirty(SPItem *item, Inkscape::Text::Layout::iterator const &position)
+{
+    if (auto text = cast<SPText>(item)) {
+        text->layout.markParagraphDirty(position);
+    } else if (auto flowtext = cast<SPFlowtext>(item)) {
+        flowtext->layout.markParagraphDirty(position);
+    }
+}
+
+/** Lays out \a item again straight away. The document update that follows
+lays it out once more from the same input, so the paragraph at \a char_index
+is marked as edited again to let that pass copy the result of this one. */
+static void te_update_layout_now (SPItem *item, int char_index)
 {
     if (is<SPText>(item))
         cast<SPText>(item)->rebuildLayout();
     else if (is<SPFlowtext>(item))
         cast<SPFlowtext>(item)->rebuildLayout();
+    if (auto layout = te_get_layout(item)) {
+        te_mark_paragraph_dirty(item, layout->charIndexToIterator(char_index));
+    }
     item->updateRepr();
 }
 
@@ -404,6 +421,7 @@ Inkscape::Text::Layout::iterator sp_te_insert_line (SPItem *item, Inkscape::Text
         return position;
         
     Inkscape::Text::Layout const *layout = te_get_layout(item);
+    te_mark_paragraph_dirty(item, position);
 
     // If this is plain SVG 1.1 text object without a tspan with sodipodi:role="line", we need
     // to wrap it or our custom line breaking code won't work!
@@ -500,7 +518,7 @@ Inkscape::Text::Layout::iterator sp_te_insert_line (SPItem *item, Inkscape::Text
     }
 
     unsigned char_index = layout->iteratorToCharIndex(position);
-    te_update_layout_now(item);
+    te_update_layout_now(item, char_index);
     item->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
     return layout->charIndexToIterator(char_index + 1);
 }
@@ -562,6 +580,7 @@ sp_te_insert(SPItem *item, Inkscape::Text::Layout::iterator const &position, gch
     SPDesktop *desktop = SP_ACTIVE_DESKTOP;
 
     Inkscape::Text::Layout const *layout = te_get_layout(item);
+    te_mark_paragraph_dirty(item, position);
     Glib::ustring::iterator iter_text;
     // we want to insert after the previous char, not before the current char.
     // it makes a difference at span boundaries
@@ -628,7 +647,7 @@ sp_te_insert(SPItem *item, Inkscape::Text::Layout::iterator const &position, gch
     }
 
     unsigned char_index = layout->iteratorToCharIndex(position);
-    te_update_layout_now(item);
+    te_update_layout_now(item, char_index);
     item->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
     return layout->charIndexToIterator(char_index + g_utf8_strlen(utf8, -1));
 }
@@ -804,6 +823,7 @@ sp_te_delete (SPItem *item, Inkscape::Text::Layout::iterator const &start,
     SPDesktop *desktop = SP_ACTIVE_DESKTOP;
     
     Inkscape::Text::Layout const *layout = te_get_layout(item);
+    te_mark_paragraph_dirty(item, iter_pair.first);
     SPObject *start_item = nullptr, *end_item = nullptr;
     Glib::ustring::iterator start_text_iter, end_text_iter;
     layout->getSourceOfCharacter(iter_pair.first, &start_item, &start_text_iter);
@@ -889,7 +909,7 @@ sp_te_delete (SPItem *item, Inkscape::Text::Layout::iterator const &start,
     }
 
     while (tidy_xml_tree_recursively(common_ancestor, has_text_decoration)){};
-    te_update_layout_now(item);
+    te_update_layout_now(item, layout->iteratorToCharIndex(iter_pair.first));
     item->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
     layout->validateIterator(&iter_pair.first);
     layout->validateIterator(&iter_pair.second);
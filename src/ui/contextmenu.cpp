@@ -207,7 +207,7 @@ ContextMenu::ContextMenu(SPDesktop *desktop, SPObject *object, bool hide_layers_
                 if (image->getClipObject()) {
                     AppendItemFromAction( gmenu_dialogs, "app.element-image-crop",                       _("Crop Image to Clip"),    ""                      );
                 }
-                if (strncmp(image->href, "data", 4) == 0) {
+                if (strncmp(image->getHref(), "data", 4) == 0) {
                     // Image is embedded.
                     AppendItemFromAction( gmenu_dialogs, "app.org.inkscape.filter.extract-image",        _("Extract Image..."),      ""                      );
                 } else {
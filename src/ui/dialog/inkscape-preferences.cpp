@@ -2977,7 +2977,7 @@ void InkscapePreferences::initPageRendering()
 
     add_devmode_group_header(_("Debugging, profiling and experiments"));
     _canvas_debug_framecheck.init("", "/options/rendering/debug_framecheck", false);
-    add_devmode_line(_("Framecheck"), _canvas_debug_framecheck, "", _("Print profiling data of selected operations to a file"));
+    add_devmode_line(_("Framecheck"), _canvas_debug_framecheck, "", _("Print profiling data of selected operations to a file, and save a trace viewable in chrome://tracing when switched off"));
     _canvas_debug_logging.init("", "/options/rendering/debug_logging", false);
     add_devmode_line(_("Logging"), _canvas_debug_logging, "", _("Log certain events to the console"));
     _canvas_debug_delay_redraw.init("", "/options/rendering/debug_delay_redraw", false);
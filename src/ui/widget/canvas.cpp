@@ -17,6 +17,7 @@
 #include <algorithm> // Sort
 #include <array>
 #include <cassert>
+#include <fstream>
 #include <iostream> // Logging
 #include <mutex>
 #include <set> // Coarsener
@@ -24,10 +25,9 @@
 #include <thread>
 #include <utility>
 #include <vector>
-#include <boost/asio/thread_pool.hpp>
-#include <boost/asio/post.hpp>
 #include <gdkmm/frameclock.h>
 #include <gdkmm/glcontext.h>
+#include <glibmm/miscutils.h>
 #include <gtkmm/applicationwindow.h>
 #include <gtkmm/gesturemultipress.h>
 #include <sigc++/functors/mem_fun.h>
@@ -53,6 +53,7 @@
 #include "ui/controller.h"
 #include "ui/tools/tool-base.h"      // Default cursor
 #include "ui/util.h"
+#include "util/worker-pool.h"
 
 #include "canvas/updaters.h"         // Update strategies
 #include "canvas/framecheck.h"       // For frame profiling
@@ -275,9 +276,7 @@ public:
     bool background_in_stores_enabled = false; // Whether the page and desk should be drawn into the stores/tiles; if not then transparency is used instead.
     bool background_in_stores_required() const { return !q->get_opengl_enabled() && SP_RGBA32_A_U(page) == 255 && SP_RGBA32_A_U(desk) == 255; } // Enable solid colour optimisation if both page and desk are solid (as opposed to checkerboard).
 
-    // Async redraw process.
-    std::optional<boost::asio::thread_pool> pool;
-    int numthreads;
+    // Async redraw process. Runs in the shared worker pool, along with the filters it renders.
     int get_numthreads() const;
 
     Synchronizer sync;
@@ -361,17 +360,25 @@ Canvas::Canvas()
             d->activate();
         }
     };
-    d->prefs.numthreads.action = [=] {
-        if (!d->active) return;
-        int const new_numthreads = d->get_numthreads();
-        if (d->numthreads == new_numthreads) return;
-        d->numthreads = new_numthreads;
-        d->deactivate();
-        d->deactivate_graphics();
-        d->pool.emplace(d->numthreads);
-        d->activate_graphics();
-        d->activate();
+    d->prefs.debug_framecheck.action = [=] {
+        // While framecheck is on, also record in memory. On switching it off, save what was recorded
+        // as a trace that can be opened in chrome://tracing or Perfetto.
+        if (d->prefs.debug_framecheck) {
+            FrameCheck::start_recording();
+            return;
+        }
+        auto const trace = FrameCheck::stop_recording();
+        if (trace.events.empty() && trace.counters.empty()) {
+            return; // Another canvas already saved it.
+        }
+        auto const filename = Glib::build_filename(Glib::get_tmp_dir(), "framecheck.json");
+        auto file = std::ofstream(filename, std::ios_base::out | std::ios_base::binary);
+        trace.write_chrome_trace(file);
+        std::cerr << "Framecheck trace saved to " << filename << std::endl;
     };
+    if (d->prefs.debug_framecheck) {
+        FrameCheck::start_recording();
+    }
 
     // Canvas item tree
     d->canvasitem_ctx.emplace(this);
@@ -391,9 +398,6 @@ Canvas::Canvas()
     set_opengl_enabled(d->prefs.request_opengl);
 
     // Async redraw process.
-    d->numthreads = d->get_numthreads();
-    d->pool.emplace(d->numthreads);
-
     d->sync.connectExit([this] { d->after_redraw(); });
 }
 
@@ -683,7 +687,7 @@ void CanvasPrivate::launch_redraw()
 
     abort_flags.store((int)AbortFlags::None, std::memory_order_relaxed);
 
-    boost::asio::post(*pool, [this] { init_tiler(); });
+    Inkscape::Util::WorkerPool::get()->post([this] { init_tiler(); });
 }
 
 void CanvasPrivate::after_redraw()
@@ -763,6 +767,9 @@ void CanvasPrivate::commit_tiles()
     }
 
     for (auto &tile : tiles) {
+        FrameCheck::count("store-upload");
+        FrameCheck::count("store-upload-pixels", tile.fragment.rect.area());
+
         // Paste tile content onto stores.
         graphics->draw_tile(tile.fragment, std::move(tile.surface), std::move(tile.outline_surface));
 
@@ -2115,8 +2122,9 @@ void CanvasPrivate::init_tiler()
 
     rd.numactive = rd.numthreads;
 
+    auto const pool = Inkscape::Util::WorkerPool::get();
     for (int i = 0; i < rd.numthreads - 1; i++) {
-        boost::asio::post(*pool, [=] { render_tile(i); });
+        pool->post([=] { render_tile(i); });
     }
 
     render_tile(rd.numthreads - 1);
@@ -2428,8 +2436,7 @@ void CanvasPrivate::paint_single_buffer(Cairo::RefPtr<Cairo::ImageSurface> const
         auto px = surface->get_data();
         int stride = surface->get_stride();
         for (int i = 0; i < surface->get_height(); i++) {
-                auto row = px + i * stride;
-                Inkscape::CMSSystem::do_transform(rd.cms_transform->getHandle(), row, row, surface->get_width());
+            rd.cms_transform->transform(px + i * stride, surface->get_width());
         }
         surface->mark_dirty();
     }
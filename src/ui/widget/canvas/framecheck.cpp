@@ -1,15 +1,110 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <boost/filesystem.hpp> // Using boost::filesystem instead of std::filesystem due to broken C++17 on MacOS.
 #include "framecheck.h"
 namespace fs = boost::filesystem;
 
 namespace Inkscape::FrameCheck {
 
+namespace {
+
+/// Most events and counter samples kept in one recording. Later ones are counted as dropped.
+constexpr std::size_t MAX_ENTRIES = 1 << 20;
+
+/// What one thread records. Only contended while a recording starts or stops.
+struct Buffer
+{
+    std::mutex mutex;
+    int thread;
+    std::vector<Record> events;
+    std::vector<CounterSample> counters; ///< Holding the increments, not the running totals.
+};
+
+struct Recorder
+{
+    std::mutex mutex;
+    int next_thread = 0;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    std::atomic<std::size_t> entries = 0;
+    std::atomic<std::size_t> dropped = 0;
+};
+
+Recorder &get_recorder()
+{
+    static Recorder recorder;
+    return recorder;
+}
+
+/// The buffer of the calling thread, shared with the recorder so that it outlives the thread.
+Buffer &get_buffer()
+{
+    thread_local auto const buffer = [] {
+        auto buffer = std::make_shared<Buffer>();
+        auto &recorder = get_recorder();
+        auto lock = std::lock_guard(recorder.mutex);
+        buffer->thread = recorder.next_thread++;
+        recorder.buffers.push_back(buffer);
+        return buffer;
+    }();
+    return *buffer;
+}
+
+/// Claim room for one more event or sample in the recording.
+bool reserve_entry()
+{
+    auto &recorder = get_recorder();
+    if (recorder.entries.fetch_add(1, std::memory_order_relaxed) >= MAX_ENTRIES) {
+        recorder.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void write_json_string(std::ostream &os, std::string const &str)
+{
+    os << '"';
+    for (unsigned char c : str) {
+        switch (c) {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n";  break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    os << buf;
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+} // namespace
+
 void Event::write()
 {
+    auto const end = g_get_monotonic_time();
+
+    // While recording, events only go to the trace, so that the threads being timed neither wait
+    // for each other nor for the file.
+    if (is_recording()) {
+        if (reserve_entry()) {
+            auto &buffer = get_buffer();
+            auto lock = std::lock_guard(buffer.mutex);
+            buffer.events.push_back({name, std::move(detail), subtype, buffer.thread, start, end});
+        }
+        return;
+    }
+
     static std::mutex mutex;
     static auto logfile = [] {
         auto path = fs::temp_directory_path() / "framecheck.txt";
@@ -18,7 +113,115 @@ void Event::write()
     }();
 
     auto lock = std::lock_guard(mutex);
-    logfile << name << ' ' << start << ' ' << g_get_monotonic_time() << ' ' << subtype << std::endl;
+    logfile << name << ' ' << start << ' ' << end << ' ' << subtype << std::endl;
+}
+
+void start_recording()
+{
+    auto &recorder = get_recorder();
+    auto lock = std::lock_guard(recorder.mutex);
+    if (detail::recording) {
+        return;
+    }
+    // Drop anything added by threads still finishing an event when the last recording stopped.
+    for (auto const &buffer : recorder.buffers) {
+        auto buffer_lock = std::lock_guard(buffer->mutex);
+        buffer->events.clear();
+        buffer->counters.clear();
+    }
+    recorder.entries = 0;
+    recorder.dropped = 0;
+    detail::recording = true;
+}
+
+Trace stop_recording()
+{
+    auto &recorder = get_recorder();
+    auto lock = std::lock_guard(recorder.mutex);
+    if (!detail::recording) {
+        return {};
+    }
+    detail::recording = false;
+
+    Trace trace;
+    for (auto const &buffer : recorder.buffers) {
+        auto buffer_lock = std::lock_guard(buffer->mutex);
+        std::move(buffer->events.begin(), buffer->events.end(), std::back_inserter(trace.events));
+        trace.counters.insert(trace.counters.end(), buffer->counters.begin(), buffer->counters.end());
+        buffer->events.clear();
+        buffer->counters.clear();
+    }
+    trace.dropped = recorder.dropped;
+
+    // Forget the buffers of threads that have exited.
+    std::erase_if(recorder.buffers, [] (auto const &buffer) { return buffer.use_count() == 1; });
+
+    // Turn the increments into running totals, in the order they were made.
+    std::stable_sort(trace.counters.begin(), trace.counters.end(), [] (auto const &a, auto const &b) {
+        return a.time < b.time;
+    });
+    std::unordered_map<std::string, gint64> totals;
+    for (auto &sample : trace.counters) {
+        sample.value = totals[sample.name] += sample.value;
+    }
+
+    return trace;
+}
+
+void count(char const *name, gint64 value)
+{
+    if (!is_recording() || !reserve_entry()) {
+        return;
+    }
+    auto const time = g_get_monotonic_time();
+    auto &buffer = get_buffer();
+    auto lock = std::lock_guard(buffer.mutex);
+    buffer.counters.push_back({name, time, value});
+}
+
+std::map<std::string, Trace::Total> Trace::totals() const
+{
+    std::map<std::string, Total> result;
+    for (auto const &event : events) {
+        auto &total = result[event.name];
+        total.count++;
+        total.duration += event.end - event.start;
+    }
+    return result;
+}
+
+void Trace::write_chrome_trace(std::ostream &os) const
+{
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto const separator = [&] {
+        if (!first) os << ",\n";
+        first = false;
+    };
+
+    for (auto const &event : events) {
+        separator();
+        os << "{\"name\":";
+        write_json_string(os, event.name);
+        os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+           << ",\"ts\":" << event.start << ",\"dur\":" << event.end - event.start
+           << ",\"args\":{\"subtype\":" << event.subtype;
+        if (!event.detail.empty()) {
+            os << ",\"detail\":";
+            write_json_string(os, event.detail);
+        }
+        os << "}}";
+    }
+
+    for (auto const &sample : counters) {
+        separator();
+        os << "{\"name\":";
+        write_json_string(os, sample.name);
+        os << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << sample.time
+           << ",\"args\":{\"value\":" << sample.value << "}}";
+    }
+
+    os << "]}\n";
 }
 
 } // namespace Inkscape::FrameCheck
@@ -2,21 +2,86 @@
 #ifndef INKSCAPE_FRAMECHECK_H
 #define INKSCAPE_FRAMECHECK_H
 
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
 #include <glib.h>
 
 namespace Inkscape::FrameCheck {
 
+/// A timed event recorded in memory.
+struct Record
+{
+    std::string name;
+    std::string detail; ///< Further information, such as the id of the object being rendered.
+    int subtype;
+    int thread;         ///< Small number identifying the thread, in order of first use.
+    gint64 start;
+    gint64 end;
+};
+
+/// A sample of a counter, taken whenever it changes.
+struct CounterSample
+{
+    char const *name;
+    gint64 time;
+    gint64 value; ///< Running total since recording started.
+};
+
+/// Everything recorded between start_recording() and stop_recording().
+struct Trace
+{
+    std::vector<Record> events;
+    std::vector<CounterSample> counters;
+    std::size_t dropped = 0; ///< Events and samples left out once the recording was full.
+
+    struct Total
+    {
+        std::size_t count = 0;
+        gint64 duration = 0;
+    };
+
+    /// Number of events and the total time spent in them, by event name.
+    std::map<std::string, Total> totals() const;
+
+    /// Write in the Chrome trace event format, as read by chrome://tracing and Perfetto.
+    void write_chrome_trace(std::ostream &os) const;
+};
+
+namespace detail {
+inline std::atomic<bool> recording = false;
+} // namespace detail
+
+/// Whether events are being recorded in memory. Cheap enough to check before every event.
+inline bool is_recording() { return detail::recording.load(std::memory_order_relaxed); }
+
+/// Start recording events and counters in memory, up to a fixed number of them. Until recording
+/// stops, events go to the recording instead of the file.
+void start_recording();
+
+/// Stop recording and return everything recorded since start_recording().
+Trace stop_recording();
+
+/// Add to the named counter if recording. The name must outlive the recording.
+void count(char const *name, gint64 value = 1);
+
 /// RAII object that logs a timing event for the duration of its lifetime.
 struct Event
 {
     gint64 start;
     char const *name;
     int subtype;
+    std::string detail;
 
     Event() : start(-1) {}
 
     Event(char const *name, int subtype = 0) : start(g_get_monotonic_time()), name(name), subtype(subtype) {}
 
+    Event(char const *name, std::string detail, int subtype = 0)
+        : start(g_get_monotonic_time()), name(name), subtype(subtype), detail(std::move(detail)) {}
+
     Event(Event &&p) { movefrom(p); }
 
     ~Event() { finish(); }
@@ -34,6 +99,7 @@ private:
         start = p.start;
         name = p.name;
         subtype = p.subtype;
+        detail = std::move(p.detail);
         p.start = -1;
     }
 
@@ -17,6 +17,7 @@
 #include <deque>
 #include <memory>
 #include <algorithm>
+#include <mutex>
 
 namespace Inkscape {
 namespace Util {
@@ -40,6 +41,9 @@ namespace Util {
  * it is not immediately deleted. As further objects are marked as unused, the oldest unused
  * objects are gradually deleted, with their number never exceeding the value max_cache_size.
  *
+ * All methods are thread-safe, and so is the release of the returned shared pointers. This does
+ * not extend to the stored objects themselves.
+ *
  * Note that the cache must not be destroyed while any shared pointers to any of its objects are
  * still active. This is in accord with its expected usage; if the factory loads objects from an
  * external library, then it should be safe to destroy the cache just before the library is
@@ -65,6 +69,7 @@ public:
      */
     auto add(Tk key, std::unique_ptr<Tv> value)
     {
+        auto lock = std::lock_guard(mutex);
         auto ret = map.emplace(std::move(key), std::move(value));
         return get_view(ret.first->second);
     }
@@ -76,6 +81,7 @@ public:
      */
     auto lookup(Tk const &key) -> std::shared_ptr<Tv>
     {
+        auto lock = std::lock_guard(mutex);
         if (auto it = map.find(key); it != map.end()) {
             return get_view(it->second);
         } else {
@@ -85,7 +91,9 @@ public:
 
     void clear()
     {
+        auto lock = std::lock_guard(mutex);
         unused.clear();
+        views.clear();
         map.clear();
     }
 
@@ -100,6 +108,8 @@ private:
     std::size_t const max_cache_size;
     std::unordered_map<Tk, Item, Hash, Compare> map;
     std::deque<Tv*> unused;
+    std::unordered_map<Tv*, int> views; // Number of views of each value still to be released.
+    std::mutex mutex;
 
     auto get_view(Item &item)
     {
@@ -107,8 +117,18 @@ private:
             return view;
         } else {
             remove_unused(item.value.get());
+            // The last copy of a view can be dropped on one thread while another thread, having
+            // seen the view expire, issues a new one before the first release gets the lock. So
+            // the views whose release is still to come are counted, and the value only becomes
+            // unused once they have all been released.
+            views[item.value.get()]++;
             auto new_view = std::shared_ptr<Tv>(item.value.get(), [this] (Tv *value) {
-                push_unused(value);
+                auto lock = std::lock_guard(mutex);
+                auto it = views.find(value);
+                if (it != views.end() && --it->second == 0) {
+                    views.erase(it);
+                    push_unused(value);
+                }
             });
             item.view = new_view;
             return new_view;
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Process-wide pool of worker threads.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "worker-pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace Inkscape::Util {
+
+/*
+ * The queue and the state the workers need outlive the pool, so that it can be dropped from
+ * anywhere without waiting, even from one of its own workers.
+ */
+struct WorkerPool::Shared
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable idle_cond; ///< Signalled when a worker starts waiting for a task.
+    std::deque<std::function<void()>> tasks;
+    int idle = 0; ///< Number of workers waiting for a task.
+    bool stop = false;
+};
+
+namespace {
+
+/// A loop being dispatched, shared between the calling thread and the workers helping it.
+struct Loop
+{
+    std::function<void (int, int, int)> const *chunk; ///< Only valid while chunks remain.
+    int count;
+    int chunk_size;
+    int num_chunks;
+    int max_threads;
+
+    std::atomic<int> next_chunk = 0;
+    std::atomic<int> next_thread = 1; ///< Thread 0 is the calling thread.
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    int finished = 0; ///< Number of chunks done.
+
+    // Claim chunks until none are left.
+    void run(int thread)
+    {
+        int done = 0;
+        for (int c; (c = next_chunk.fetch_add(1, std::memory_order_relaxed)) < num_chunks; ) {
+            int const begin = c * chunk_size;
+            (*chunk)(begin, std::min(begin + chunk_size, count), thread);
+            done++;
+        }
+
+        if (done > 0) {
+            auto lock = std::lock_guard(mutex);
+            finished += done;
+            if (finished == num_chunks) {
+                cond.notify_all();
+            }
+        }
+    }
+};
+
+std::mutex global_mutex;
+std::shared_ptr<WorkerPool> global_pool;
+
+} // namespace
+
+int default_numthreads()
+{
+    auto const n = std::thread::hardware_concurrency();
+    return n == 0 ? 4 : n; // Sensible fallback if not reported.
+}
+
+WorkerPool::WorkerPool(int size)
+    : _shared(std::make_shared<Shared>())
+    , _size(std::max(size, 1))
+{
+    for (int i = 0; i < _size; ++i) {
+        std::thread(_work, _shared).detach();
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        auto lock = std::lock_guard(_shared->mutex);
+        _shared->stop = true;
+    }
+    _shared->cond.notify_all();
+}
+
+void WorkerPool::_work(std::shared_ptr<Shared> shared)
+{
+    auto lock = std::unique_lock(shared->mutex);
+    while (true) {
+        if (shared->tasks.empty()) {
+            if (shared->stop) {
+                return;
+            }
+            shared->idle++;
+            shared->idle_cond.notify_all();
+            shared->cond.wait(lock, [&] { return !shared->tasks.empty() || shared->stop; });
+            shared->idle--;
+            continue;
+        }
+
+        auto task = std::move(shared->tasks.front());
+        shared->tasks.pop_front();
+        lock.unlock();
+        task();
+        task = {};
+        lock.lock();
+    }
+}
+
+void WorkerPool::post(std::function<void()> task)
+{
+    {
+        auto lock = std::lock_guard(_shared->mutex);
+        _shared->tasks.push_back(std::move(task));
+    }
+    _shared->cond.notify_one();
+}
+
+void WorkerPool::wait_idle()
+{
+    auto lock = std::unique_lock(_shared->mutex);
+    _shared->idle_cond.wait(lock, [&] { return _shared->idle == _size && _shared->tasks.empty(); });
+}
+
+void WorkerPool::_dispatch(int count, int max_threads, std::function<void (int, int, int)> const &chunk)
+{
+    // A few chunks per thread, so that threads joining late or running slowly still balance out.
+    auto loop = std::make_shared<Loop>();
+    loop->chunk = &chunk;
+    loop->count = count;
+    loop->num_chunks = std::min(count, 4 * max_threads);
+    loop->chunk_size = (count + loop->num_chunks - 1) / loop->num_chunks;
+    loop->num_chunks = (count + loop->chunk_size - 1) / loop->chunk_size;
+    loop->max_threads = max_threads;
+
+    // Only ask for help from workers that would otherwise sit idle.
+    int helpers;
+    {
+        auto lock = std::lock_guard(_shared->mutex);
+        int const available = _shared->idle - static_cast<int>(_shared->tasks.size());
+        helpers = std::clamp(std::min(max_threads, loop->num_chunks) - 1, 0, std::max(available, 0));
+        for (int i = 0; i < helpers; ++i) {
+            _shared->tasks.emplace_back([loop] {
+                // The loop may be finished by the time this runs, in which case there is nothing to claim.
+                int const thread = loop->next_thread.fetch_add(1, std::memory_order_relaxed);
+                if (thread < loop->max_threads) {
+                    loop->run(thread);
+                }
+            });
+        }
+    }
+    for (int i = 0; i < helpers; ++i) {
+        _shared->cond.notify_one();
+    }
+
+    loop->run(0);
+
+    // Wait for the chunks claimed by helpers. Chunks are only claimed by threads already running
+    // them, so this never waits for a worker to become free.
+    auto lock = std::unique_lock(loop->mutex);
+    loop->cond.wait(lock, [&] { return loop->finished == loop->num_chunks; });
+}
+
+std::shared_ptr<WorkerPool> WorkerPool::get()
+{
+    auto lock = std::lock_guard(global_mutex);
+    if (!global_pool) {
+        global_pool = std::make_shared<WorkerPool>(default_numthreads());
+    }
+    return global_pool;
+}
+
+void WorkerPool::set_size(int size)
+{
+    size = std::max(size, 1);
+
+    std::shared_ptr<WorkerPool> old;
+    auto lock = std::lock_guard(global_mutex);
+    if (global_pool && global_pool->size() == size) {
+        return;
+    }
+    old = std::move(global_pool);
+    global_pool = std::make_shared<WorkerPool>(size);
+}
+
+} // namespace Inkscape::Util
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
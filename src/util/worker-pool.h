@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Process-wide pool of worker threads.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+#ifndef INKSCAPE_UTIL_WORKER_POOL_H
+#define INKSCAPE_UTIL_WORKER_POOL_H
+
+#include <functional>
+#include <memory>
+
+namespace Inkscape::Util {
+
+/// Number of threads to use when /options/threading/numthreads is unset: one per processor.
+int default_numthreads();
+
+/**
+ * A fixed set of worker threads shared by everything that renders in parallel: canvas tiles,
+ * filter primitives, export, image colour conversion and text layout.
+ *
+ * Tasks can be posted to run in the background, or a loop can be dispatched to run in parallel.
+ * The thread dispatching a loop always works on it too, and only idle workers join in. So a loop
+ * dispatched from a thread that is already busy, such as a filter rendered inside a canvas tile,
+ * splits its iterations among whichever workers are free instead of starting new threads, and
+ * runs entirely on the calling thread when the pool is fully occupied.
+ */
+class WorkerPool final
+{
+public:
+    explicit WorkerPool(int size);
+    WorkerPool(WorkerPool const &) = delete;
+    WorkerPool &operator=(WorkerPool const &) = delete;
+
+    /// Does not wait: the workers run the tasks still queued, then exit on their own.
+    ~WorkerPool();
+
+    int size() const { return _size; }
+
+    /// Queue a task to run on a worker.
+    void post(std::function<void()> task);
+
+    /// Wait until every worker is waiting for a task, including those of a new pool still starting up.
+    void wait_idle();
+
+    /**
+     * Call f(i, thread) for every i in [0, count), on at most max_threads threads including the
+     * calling one, and return once all calls have finished. The thread argument is less than
+     * max_threads and differs between calls running at the same time, so it can index per-thread
+     * scratch space.
+     */
+    template <typename F>
+    void dispatch(int count, int max_threads, F &&f)
+    {
+        if (max_threads <= 1 || count <= 1) {
+            for (int i = 0; i < count; ++i) {
+                f(i, 0);
+            }
+            return;
+        }
+        _dispatch(count, max_threads, [&] (int begin, int end, int thread) {
+            for (int i = begin; i < end; ++i) {
+                f(i, thread);
+            }
+        });
+    }
+
+    /// The shared pool, created with default_numthreads() threads on first use.
+    static std::shared_ptr<WorkerPool> get();
+
+    /// Replace the shared pool with one of the given size, unless it already has that size.
+    /// Whoever still holds the old pool can keep using it.
+    static void set_size(int size);
+
+private:
+    struct Shared;
+    std::shared_ptr<Shared> _shared;
+    int _size;
+
+    static void _work(std::shared_ptr<Shared> shared);
+    void _dispatch(int count, int max_threads, std::function<void (int, int, int)> const &chunk);
+};
+
+} // namespace Inkscape::Util
+
+#endif // INKSCAPE_UTIL_WORKER_POOL_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -642,6 +642,50 @@ Glib::ustring sp_repr_save_buf(Document *doc)
 }
 
 
+namespace {
+
+/// Output stream appending to a std::string, which unlike a Glib::ustring takes bytes as they are.
+class StdStringOutputStream : public Inkscape::IO::OutputStream
+{
+public:
+    StdStringOutputStream(std::string &buffer) : _buffer(buffer) {}
+
+    void close() override {}
+    void flush() override {}
+
+    int put(char ch) override
+    {
+        _buffer.push_back(ch);
+        return 1;
+    }
+
+    int write(char const *data, std::size_t size) override
+    {
+        _buffer.append(data, size);
+        return size;
+    }
+
+private:
+    std::string &_buffer;
+};
+
+} // namespace
+
+/**
+ * Serialize a document into memory, so that the caller can take writing it to disk elsewhere.
+ */
+std::string sp_repr_save_string(Document *doc, gchar const *default_ns)
+{
+    std::string buffer;
+    StdStringOutputStream souts(buffer);
+    Inkscape::IO::OutputStreamWriter outs(souts);
+
+    sp_repr_save_writer(doc, &outs, default_ns, nullptr, nullptr);
+
+    outs.close();
+    return buffer;
+}
+
 void sp_repr_save_stream(Document *doc, FILE *fp, gchar const *default_ns, bool compress,
                     gchar const *const old_href_abs_base,
                     gchar const *const new_href_abs_base)
@@ -731,15 +775,22 @@ bool sp_repr_save_file(Document *doc, gchar const *const filename, gchar const *
 static void repr_quote_write (Writer &out, const gchar * val, bool attr)
 {
     if (val) {
-        for (; *val != '\0'; val++) {
+        while (*val != '\0') {
+            // Pass on the characters up to the next one to be escaped in one go.
+            auto const plain = std::strcspn(val, "\"&<>\n");
+            if (plain > 0) {
+                out.write(val, plain);
+                val += plain;
+                continue;
+            }
             switch (*val) {
                 case '"': out.writeString( "&quot;" ); break;
                 case '&': out.writeString( "&amp;" ); break;
                 case '<': out.writeString( "&lt;" ); break;
                 case '>': out.writeString( "&gt;" ); break;
                 case '\n': out.writeString( attr ? "&#10;" : "\n" ); break;
-                default: out.writeChar( *val ); break;
             }
+            val++;
         }
     }
 }
@@ -15,6 +15,7 @@
 #ifndef SEEN_SP_REPR_H
 #define SEEN_SP_REPR_H
 
+#include <string>
 #include <vector>
 #include <glibmm/quark.h>
 
@@ -61,6 +62,7 @@ void sp_repr_write_stream(Inkscape::XML::Node *repr, Inkscape::IO::Writer &out,
                           char const *new_href_base = nullptr);
 Inkscape::XML::Document *sp_repr_read_buf (const Glib::ustring &buf, const char *default_ns);
 Glib::ustring sp_repr_save_buf(Inkscape::XML::Document *doc);
+std::string sp_repr_save_string(Inkscape::XML::Document *doc, char const *default_ns = nullptr);
 
 // TODO convert to std::string
 void sp_repr_save_stream(Inkscape::XML::Document *doc, FILE *to_file,
@@ -319,12 +319,14 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
     g_assert(std::none_of(name, name + strlen(name), [](char c) { return g_ascii_isspace(c); }));
 
     // Check usefulness of attributes on elements in the svg namespace, optionally don't add them to tree.
-    Glib::ustring element = g_quark_to_string(_name);
-    //g_message("setAttribute:  %s: %s: %s", element.c_str(), name, value);
-    gchar* cleaned_value = g_strdup( value );
+    gchar const *element = g_quark_to_string(_name);
+    //g_message("setAttribute:  %s: %s: %s", element, name, value);
+    // Values can be huge, e.g. embedded images, so only copy them once, into the shared string.
+    std::string cleaned_style;
+    gchar const *cleaned_value = value;
 
     // Only check elements in SVG name space and don't block setting attribute to NULL.
-    if( element.substr(0,4) == "svg:" && value != nullptr) {
+    if( !strncmp(element, "svg:", 4) && value != nullptr) {
 
         Inkscape::Preferences *prefs = Inkscape::Preferences::get();
         if( prefs->getBool("/options/svgoutput/check_on_editing") ) {
@@ -339,7 +341,6 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
             if( (attr_warn || attr_remove) && value != nullptr ) {
                 bool is_useful = sp_attribute_check_attribute( element, id, name, attr_warn );
                 if( !is_useful && attr_remove ) {
-                    g_free( cleaned_value );
                     return; // Don't add to tree.
                 }
             }
@@ -347,8 +348,8 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
             // Check style properties -- Note: if element is not yet inserted into
             // tree (and thus has no parent), default values will not be tested.
             if( !strcmp( name, "style" ) && (flags >= SP_ATTRCLEAN_STYLE_WARN) ) {
-                g_free( cleaned_value );
-                cleaned_value = g_strdup( sp_attribute_clean_style( this, value, flags ).c_str() );
+                cleaned_style = sp_attribute_clean_style( this, value, flags );
+                cleaned_value = cleaned_style.c_str();
                 // if( g_strcmp0( value, cleaned_value ) ) {
                 //     g_warning( "SimpleNode::setAttribute: %s", id.c_str() );
                 //     g_warning( "     original: %s", value);
@@ -367,6 +368,12 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
             break;
         }
     }
+
+    // Keep the existing shared value if nothing changes, rather than storing a copy of it.
+    if (ref && cleaned_value && !strcmp(ref->value, cleaned_value)) {
+        return;
+    }
+
     Debug::EventTracker<> tracker;
 
     ptr_shared old_value=( ref ? ref->value : ptr_shared() );
@@ -392,7 +399,6 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
         _observers.notifyAttributeChanged(*this, key, old_value, new_value);
         //g_warning( "setAttribute notified: %s: %s: %s: %s", name, element.c_str(), old_value, new_value ); 
     }
-    g_free( cleaned_value );
 }
 
 void SimpleNode::setCodeUnsafe(int code) {
@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Benchmark of the filter primitives, run over the shipped filter presets.
+ *
+ * Every filter in share/filters/filters.svg is applied to a test graphic and rendered at several
+ * sizes and thread counts. The time spent in Filters::Filter::render and in each of its primitives
+ * is taken from FrameCheck recordings, and written out as JSON together with the throughput in
+ * megapixels of output per second. While recording, FrameCheck keeps events in per-thread memory
+ * and does not write them to its log file, so the timings only include the rendering.
+ *
+ * Usage: filter_benchmark [--sizes 256,1024] [--threads 1,N] [--repeat 3] [--filter ID]
+ *                         [--output FILE] [FILTERS.SVG]
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glib.h>
+#include <giomm/init.h>
+#include <cairomm/surface.h>
+#include <2geom/int-rect.h>
+
+#include "document.h"
+#include "inkscape.h"
+#include "preferences.h"
+#include "display/cairo-utils.h"
+#include "display/drawing.h"
+#include "display/drawing-context.h"
+#include "display/drawing-surface.h"
+#include "display/nr-filter-normal-map.h"
+#include "inkgc/gc-core.h"
+#include "object/sp-filter.h"
+#include "object/sp-item.h"
+#include "object/sp-root.h"
+#include "ui/widget/canvas/framecheck.h"
+#include "util/statics.h"
+#include "util/worker-pool.h"
+#include "xml/repr.h"
+
+using namespace Inkscape;
+
+namespace {
+
+char const *const NUMTHREADS_PREF = "/options/threading/numthreads";
+
+struct Options
+{
+    std::vector<int> sizes = {256, 1024};
+    std::vector<int> threads = {1, std::max<int>(std::thread::hardware_concurrency(), 1)};
+    int repeat = 3;
+    std::string filter; ///< Only benchmark the filter with this id, if set.
+    std::string output; ///< Write to standard output if empty.
+    std::string filters_file = INKSCAPE_TESTS_DIR "/../share/filters/filters.svg";
+};
+
+std::vector<int> parse_list(char const *str)
+{
+    std::vector<int> result;
+    std::istringstream in(str);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        int value = std::atoi(item.c_str());
+        if (value > 0) {
+            result.push_back(value);
+        }
+    }
+    return result;
+}
+
+bool parse_options(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        auto const has_value = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--sizes") && has_value) {
+            options.sizes = parse_list(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && has_value) {
+            options.threads = parse_list(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--repeat") && has_value) {
+            options.repeat = std::max(std::atoi(argv[++i]), 1);
+        } else if (!std::strcmp(argv[i], "--filter") && has_value) {
+            options.filter = argv[++i];
+        } else if (!std::strcmp(argv[i], "--output") && has_value) {
+            options.output = argv[++i];
+        } else if (argv[i][0] != '-') {
+            options.filters_file = argv[i];
+        } else {
+            return false;
+        }
+    }
+    return !options.sizes.empty() && !options.threads.empty();
+}
+
+void write_json_string(std::ostream &os, std::string const &str)
+{
+    os << '"';
+    for (unsigned char c : str) {
+        switch (c) {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    os << buf;
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+/**
+ * The graphic the filters are applied to: a radial gradient fading out towards the corners, with
+ * a stroked circle on top, so that the filters see both smooth and sharp changes in colour and
+ * alpha. Its geometric bounding box is size by size user units, starting at the origin.
+ */
+SPItem *create_source_graphic(SPDocument *doc, int size)
+{
+    auto xml_doc = doc->getReprDoc();
+    auto const side = std::to_string(size);
+
+    auto group = xml_doc->createElement("svg:g");
+    group->setAttribute("id", "benchmark-graphic");
+
+    auto gradient = xml_doc->createElement("svg:radialGradient");
+    gradient->setAttribute("id", "benchmark-gradient");
+    for (auto [offset, style] : {std::pair{"0", "stop-color:#ff8000;stop-opacity:1"},
+                                 std::pair{"0.6", "stop-color:#2080ff;stop-opacity:0.7"},
+                                 std::pair{"1", "stop-color:#204000;stop-opacity:0"}}) {
+        auto stop = xml_doc->createElement("svg:stop");
+        stop->setAttribute("offset", offset);
+        stop->setAttribute("style", style);
+        gradient->appendChild(stop);
+        GC::release(stop);
+    }
+    group->appendChild(gradient);
+    GC::release(gradient);
+
+    auto rect = xml_doc->createElement("svg:rect");
+    rect->setAttribute("width", side);
+    rect->setAttribute("height", side);
+    rect->setAttribute("style", "fill:url(#benchmark-gradient)");
+    group->appendChild(rect);
+    GC::release(rect);
+
+    auto circle = xml_doc->createElement("svg:circle");
+    circle->setAttribute("cx", std::to_string(size / 2.0));
+    circle->setAttribute("cy", std::to_string(size / 2.0));
+    circle->setAttribute("r", std::to_string(size / 4.0));
+    circle->setAttribute("style", "fill:#40c040;stroke:#000000;stroke-width:" + std::to_string(size / 32.0));
+    group->appendChild(circle);
+    GC::release(circle);
+
+    doc->getRoot()->getRepr()->appendChild(group);
+    GC::release(group);
+
+    return cast<SPItem>(doc->getObjectByRepr(group));
+}
+
+/// Time spent in one render, in microseconds.
+struct Timings
+{
+    gint64 filter = 0;
+    std::map<std::string, gint64> primitives;
+};
+
+/**
+ * Use the given number of threads for rendering. Every Drawing sets the number of filter threads
+ * and the worker pool size from the preferences when it is created, so they are set there, which
+ * leaves the pool alone as long as the number stays the same.
+ */
+void set_threads(int threads)
+{
+    Preferences::get()->setInt(NUMTHREADS_PREF, threads);
+    set_num_filter_threads(threads);
+    Util::WorkerPool::set_size(threads);
+}
+
+/// Render the item once, into a fresh drawing so that nothing is cached from earlier renders.
+Timings render_once(SPItem *item, int size)
+{
+    Filters::NormalMap::clear_cache();
+
+    Drawing drawing;
+    drawing.setExact();
+    auto const dkey = SPItem::display_key_new(1);
+    drawing.setRoot(item->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+    drawing.update();
+
+    auto const area = Geom::IntRect::from_xywh(0, 0, size, size);
+    auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, size, size);
+    auto ds = DrawingSurface(surface->cobj(), area.min());
+    auto dc = DrawingContext(ds);
+
+    // Only idle workers help with a filter, so wait for all of them to be available, including
+    // those of a new pool that are still starting up.
+    Util::WorkerPool::get()->wait_idle();
+
+    FrameCheck::start_recording();
+    drawing.render(dc, area);
+    auto const trace = FrameCheck::stop_recording();
+    if (trace.dropped) {
+        std::cerr << "Recording full, " << trace.dropped << " events left out" << std::endl;
+    }
+
+    item->invoke_hide(dkey);
+
+    Timings timings;
+    for (auto const &event : trace.events) {
+        auto const duration = event.end - event.start;
+        if (event.name == "filter") {
+            timings.filter += duration;
+        } else if (event.name == "filter-primitive") {
+            timings.primitives[event.detail] += duration;
+        }
+    }
+    return timings;
+}
+
+gint64 median(std::vector<gint64> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+void write_timing(std::ostream &os, gint64 usec, int size)
+{
+    // Pixels per microsecond are megapixels per second.
+    double const mpix_per_s = usec > 0 ? static_cast<double>(size) * size / usec : 0.0;
+    os << "{\"usec\":" << usec << ",\"mpix_per_s\":" << mpix_per_s << "}";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--sizes 256,1024] [--threads 1,N] [--repeat 3] [--filter ID]"
+                     " [--output FILE] [FILTERS.SVG]" << std::endl;
+        return 1;
+    }
+
+    Gio::init();
+    GC::init();
+    if (!Application::exists()) {
+        Application::create(false);
+    }
+
+    auto doc = std::unique_ptr<SPDocument>(SPDocument::createNewDoc(options.filters_file.c_str(), false));
+    if (!doc) {
+        std::cerr << "Could not load " << options.filters_file << std::endl;
+        return 1;
+    }
+
+    std::vector<SPFilter *> filters;
+    for (auto obj : doc->getResourceList("filter")) {
+        auto filter = cast<SPFilter>(obj);
+        if (filter && filter->getId() && (options.filter.empty() || options.filter == filter->getId())) {
+            filters.push_back(filter);
+        }
+    }
+    std::sort(filters.begin(), filters.end(), [] (SPFilter *a, SPFilter *b) {
+        return std::strcmp(a->getId(), b->getId()) < 0;
+    });
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "Could not write " << options.output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &os = options.output.empty() ? std::cout : file;
+
+    os << "{\"filters_file\":";
+    write_json_string(os, options.filters_file);
+    os << ",\"repeat\":" << options.repeat << ",\"results\":[";
+
+    // The thread count is changed through the preferences while benchmarking; put it back after.
+    auto const prefs = Preferences::get();
+    auto const entry = prefs->getEntry(NUMTHREADS_PREF);
+    auto const saved_threads = entry.isValid() ? std::optional(entry.getInt()) : std::nullopt;
+
+    bool first = true;
+    for (auto const size : options.sizes) {
+        auto item = create_source_graphic(doc.get(), size);
+
+        for (auto const filter : filters) {
+            auto const id = std::string(filter->getId());
+            item->setAttribute("style", "filter:url(#" + id + ")");
+            doc->ensureUpToDate();
+
+            for (auto const threads : options.threads) {
+                set_threads(threads);
+
+                std::vector<gint64> filter_times;
+                std::map<std::string, std::vector<gint64>> primitive_times;
+                for (int i = 0; i < options.repeat; ++i) {
+                    auto const timings = render_once(item, size);
+                    filter_times.push_back(timings.filter);
+                    for (auto const &[name, usec] : timings.primitives) {
+                        primitive_times[name].push_back(usec);
+                    }
+                }
+
+                os << (first ? "\n" : ",\n") << "{\"id\":";
+                first = false;
+                write_json_string(os, id);
+                os << ",\"label\":";
+                write_json_string(os, filter->label() ? filter->label() : "");
+                os << ",\"size\":" << size << ",\"threads\":" << threads << ",\"filter\":";
+                write_timing(os, median(filter_times), size);
+                os << ",\"primitives\":{";
+                bool first_primitive = true;
+                for (auto &[name, times] : primitive_times) {
+                    // A primitive that did not run in every repetition counts as taking no time.
+                    times.resize(options.repeat, 0);
+                    os << (first_primitive ? "" : ",");
+                    first_primitive = false;
+                    write_json_string(os, name);
+                    os << ":";
+                    write_timing(os, median(times), size);
+                }
+                os << "}}";
+            }
+
+            std::cerr << id << " at " << size << "px done" << std::endl;
+        }
+
+        item->deleteObject(false);
+    }
+
+    os << "\n]}" << std::endl;
+
+    if (saved_threads) {
+        prefs->setInt(NUMTHREADS_PREF, *saved_threads);
+    } else {
+        prefs->remove(NUMTHREADS_PREF);
+    }
+    doc.reset();
+    Util::StaticsBin::get().destroy();
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
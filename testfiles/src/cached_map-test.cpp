@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Test Inkscape::Util::cached_map
+ */
+/*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "util/cached_map.h"
+
+using Inkscape::Util::cached_map;
+
+namespace {
+
+std::atomic<int> constructed;
+std::atomic<int> destroyed;
+
+struct Value
+{
+    static constexpr int ALIVE = 0x600d;
+    int key;
+    int state = ALIVE;
+    Value(int key) : key(key) { constructed++; }
+    ~Value() { state = 0; destroyed++; }
+};
+
+auto get(cached_map<int, Value> &map, int key)
+{
+    if (auto value = map.lookup(key)) {
+        return value;
+    }
+    return map.add(key, std::make_unique<Value>(key));
+}
+
+} // namespace
+
+TEST(CachedMapTest, KeepsUnusedValues)
+{
+    constructed = destroyed = 0;
+    {
+        cached_map<int, Value> map(2);
+
+        auto a = get(map, 1);
+        EXPECT_EQ(a->key, 1);
+        EXPECT_EQ(map.lookup(1), a);
+        EXPECT_FALSE(map.lookup(2));
+
+        // Released values stay available until more than two are unused.
+        a.reset();
+        get(map, 2);
+        EXPECT_EQ(destroyed.load(), 0);
+        get(map, 3);
+        EXPECT_EQ(destroyed.load(), 1);
+        EXPECT_FALSE(map.lookup(1));
+
+        // Values in use are never evicted.
+        auto b = get(map, 5);
+        for (int i = 6; i < 10; i++) {
+            get(map, i);
+        }
+        EXPECT_EQ(map.lookup(5), b);
+        EXPECT_EQ(b->state, Value::ALIVE);
+    }
+    EXPECT_EQ(constructed.load(), destroyed.load());
+}
+
+// Views of the same values are released and re-issued concurrently, which exercises the case of a
+// view being re-issued while the release of the previous one is still waiting for the lock.
+TEST(CachedMapTest, ReleaseFromManyThreads)
+{
+    constexpr int num_threads = 8;
+    constexpr int num_keys = 6;
+    constexpr int iterations = 20000;
+
+    constructed = destroyed = 0;
+    {
+        cached_map<int, Value> map(2);
+        std::atomic<int> errors = 0;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < iterations; i++) {
+                    int const key = (i + t) % num_keys;
+                    auto value = get(map, key);
+                    if (value->key != key || value->state != Value::ALIVE) {
+                        errors++;
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(errors.load(), 0);
+
+        // At most two values are kept once nothing uses them any more.
+        EXPECT_LE(constructed.load() - destroyed.load(), 2);
+    }
+    EXPECT_EQ(constructed.load(), destroyed.load());
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
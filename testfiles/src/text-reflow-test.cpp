@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Test that relaying out text incrementally after an edit gives the same result as laying it out
+ * from scratch.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2023 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "document.h"
+#include "inkscape.h"
+#include "text-editing.h"
+#include "object/sp-flowtext.h"
+#include "object/sp-string.h"
+#include "object/sp-text.h"
+#include "svg/svg.h"
+
+using namespace Inkscape;
+using Inkscape::Text::Layout;
+
+namespace {
+
+char const *const svg = R"(<svg xmlns='http://www.w3.org/2000/svg'
+  xmlns:sodipodi='http://sodipodi.sourceforge.net/DTD/sodipodi-0.dtd' width='400' height='800'>
+<text id='text' x='10' y='20' style='font-size:10px;line-height:1.25;font-family:sans-serif'><tspan sodipodi:role='line' x='10' y='20'>The first paragraph of the text.</tspan><tspan sodipodi:role='line' x='10' y='32.5'>A second one, a little longer than the first.</tspan><tspan sodipodi:role='line' x='10' y='45'>The third.</tspan><tspan sodipodi:role='line' x='10' y='57.5'>And the last paragraph.</tspan></text>
+<flowRoot id='flow' style='font-size:10px;line-height:1.25;font-family:sans-serif'><flowRegion><rect x='10' y='100' width='120' height='40'/><rect x='10' y='200' width='120' height='300'/></flowRegion><flowPara>The first paragraph wraps over a couple of lines in the first region.</flowPara><flowPara>The second one does too, and runs over into the second region.</flowPara><flowPara>Short.</flowPara><flowPara>And the last paragraph, which ends up in the second region as well.</flowPara></flowRoot>
+</svg>)";
+
+/// Where object sits in the document, so that objects of two copies of it can be compared.
+std::string describe_object(SPObject const *object)
+{
+    std::string result;
+    for (; object && object->parent; object = object->parent) {
+        result = std::to_string(object->getRepr()->position()) + '/' + result;
+    }
+    return result;
+}
+
+/// Everything about the layout of the text in item that the public interface tells.
+std::string describe_layout(SPItem const *item)
+{
+    auto layout = te_get_layout(item);
+    std::ostringstream out;
+    for (auto it = layout->begin(); it != layout->end(); it.nextCharacter()) {
+        SPObject *source = nullptr;
+        Glib::ustring::iterator text;
+        layout->getSourceOfCharacter(it, &source, &text);
+        auto const anchor = layout->characterAnchorPoint(it);
+        auto const box = layout->characterBoundingBox(it);
+        out << layout->paragraphIndex(it) << ' ' << layout->lineIndex(it) << ' ' << layout->shapeIndex(it) << ' '
+            << layout->characterAt(it) << ' ' << layout->isHidden(it) << ' '
+            << anchor[Geom::X] << ',' << anchor[Geom::Y] << ' '
+            << box.left() << ',' << box.top() << ',' << box.right() << ',' << box.bottom() << ' '
+            << describe_object(source);
+        if (auto string = cast<SPString>(source)) {
+            out << ' ' << text.base() - string->string.begin().base();
+        }
+        out << '\n';
+    }
+    out << sp_svg_write_path(layout->convertToCurves().get_pathvector());
+    return out.str();
+}
+
+void rebuild_layout(SPItem *item)
+{
+    if (auto text = cast<SPText>(item)) {
+        text->rebuildLayout();
+    } else if (auto flowtext = cast<SPFlowtext>(item)) {
+        flowtext->rebuildLayout();
+    }
+}
+
+/// Position offset characters into the given paragraph.
+Layout::iterator position(SPItem const *item, unsigned paragraph, int offset)
+{
+    auto layout = te_get_layout(item);
+    auto it = layout->begin();
+    while (it != layout->end() && layout->paragraphIndex(it) < paragraph) {
+        it.nextCharacter();
+    }
+    return layout->charIndexToIterator(layout->iteratorToCharIndex(it) + offset);
+}
+
+} // namespace
+
+/**
+ * Every edit is made both to a text that is laid out again incrementally, as in the text tool,
+ * and to a copy of it that is laid out from scratch afterwards. Laying out the copy from scratch
+ * does not disturb the chain of incremental layouts of the original, where the output of each
+ * layout is reused by the next.
+ */
+class TextReflowTest : public ::testing::TestWithParam<char const *>
+{
+protected:
+    void SetUp() override
+    {
+        if (!Application::exists()) {
+            Application::create(false);
+        }
+        for (auto &copy : copies) {
+            copy.doc.reset(SPDocument::createNewDocFromMem(svg, std::strlen(svg), false));
+            ASSERT_TRUE(copy.doc);
+            copy.doc->ensureUpToDate();
+            copy.item = cast<SPItem>(copy.doc->getObjectById(GetParam()));
+            ASSERT_TRUE(copy.item);
+        }
+    }
+
+    template <typename F>
+    void edit(F const &f)
+    {
+        for (auto &copy : copies) {
+            f(copy.item);
+            copy.doc->ensureUpToDate();
+        }
+        auto &incremental = copies[0];
+        auto &full = copies[1];
+        rebuild_layout(full.item);
+        EXPECT_EQ(describe_layout(incremental.item), describe_layout(full.item));
+    }
+
+    void insert(unsigned paragraph, int offset, char const *utf8)
+    {
+        edit([&] (SPItem *item) {
+            sp_te_insert(item, position(item, paragraph, offset), utf8);
+        });
+    }
+
+    void insert_line(unsigned paragraph, int offset)
+    {
+        edit([&] (SPItem *item) {
+            auto it = position(item, paragraph, offset);
+            sp_te_insert_line(item, it);
+        });
+    }
+
+    void erase(unsigned paragraph, int offset, int length)
+    {
+        edit([&] (SPItem *item) {
+            auto layout = te_get_layout(item);
+            auto start = position(item, paragraph, offset);
+            auto end = layout->charIndexToIterator(layout->iteratorToCharIndex(start) + length);
+            iterator_pair pair;
+            sp_te_delete(item, start, end, pair);
+        });
+    }
+
+    struct Copy
+    {
+        std::unique_ptr<SPDocument> doc;
+        SPItem *item = nullptr;
+    };
+    Copy copies[2];
+};
+
+// Edits are repeated, since only the output of a layout that was itself calculated incrementally
+// can be reused.
+
+TEST_P(TextReflowTest, InsertInFirstParagraph)
+{
+    for (int i = 0; i < 3; i++) {
+        insert(0, 4, "many words ");
+    }
+}
+
+TEST_P(TextReflowTest, InsertInMiddleParagraph)
+{
+    for (int i = 0; i < 3; i++) {
+        insert(1, 10, "and longer still ");
+    }
+}
+
+TEST_P(TextReflowTest, InsertInLastParagraph)
+{
+    for (int i = 0; i < 3; i++) {
+        insert(3, 0, "x");
+    }
+}
+
+TEST_P(TextReflowTest, DeleteInFirstParagraph)
+{
+    for (int i = 0; i < 3; i++) {
+        erase(0, 2, 3);
+    }
+}
+
+TEST_P(TextReflowTest, DeleteInMiddleParagraph)
+{
+    for (int i = 0; i < 3; i++) {
+        erase(1, 5, 4);
+    }
+}
+
+TEST_P(TextReflowTest, DeleteInLastParagraph)
+{
+    for (int i = 0; i < 3; i++) {
+        erase(3, 0, 2);
+    }
+}
+
+TEST_P(TextReflowTest, DeleteAcrossParagraphs)
+{
+    erase(0, 10, 30);
+    erase(1, 3, 20);
+}
+
+TEST_P(TextReflowTest, InsertAndDeleteParagraphs)
+{
+    insert_line(1, 5);
+    insert_line(0, 0);
+    erase(2, 0, 1);
+    insert_line(4, 2);
+}
+
+INSTANTIATE_TEST_SUITE_P(TextAndFlowtext, TextReflowTest, ::testing::Values("text", "flow"));
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :